@@ -0,0 +1,539 @@
+// Microbenchmarks for the hot kernels of the game.
+//
+// Every case uses fixed camera poses and deterministic maps so numbers are
+// comparable between runs and machines. Run with --help for options.
+
+#include "harness.h"
+
+#include "bots.h"
+#include "client.h"
+#include "game.h"
+#include "minimap.h"
+#include "render.h"
+#include "present.h"
+#include "scenes.h"
+#include "server.h"
+#include "spectate.h"
+#include "verify.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef FPS_GOLDEN_DIR
+#define FPS_GOLDEN_DIR "bench/golden"
+#endif
+
+#ifndef FPS_VERIFY_REPLAY
+#define FPS_VERIFY_REPLAY "replays/pgo_training.txt"
+#endif
+
+static void benchRaycast(BenchRunner& runner) {
+    // Every column, rays for every 2nd and 3rd column with reconstruction,
+    // then sparse rays refined around edges
+    static const int STEPS[] = { 1, 2, 3, 1 };
+    static const int SPANS[] = { 0, 0, 0, 8 };
+    static const char* const NAMES[] = { "raycast", "raycast.columns2", "raycast.columns3", "raycast.refine" };
+    
+    std::vector<ColumnHit> hits;
+    for (int s = 0; s < 4; s++) {
+        renderQuality.columnStep = STEPS[s];
+        renderQuality.refineSpan = SPANS[s];
+        for (int m = 0; m < MAP_COUNT; m++) {
+            loadMapCase(MAPS[m]);
+            for (int r = 0; r < RESOLUTION_COUNT; r++) {
+                const Resolution& res = RESOLUTIONS[r];
+                std::string params = std::string(MAPS[m].name) + " " + resName(res);
+                hits.resize(res.width);
+                if (!runner.selected(NAMES[s])) continue;
+                runner.run(NAMES[s], params, [&]() {
+                    for (size_t p = 0; p < poses.size(); p++) {
+                        setPose(poses[p]);
+                        castRays(res.width, &hits[0]);
+                    }
+                });
+                
+                // How many of the columns actually needed a ray
+                int rays = 0;
+                for (size_t p = 0; p < poses.size(); p++) {
+                    setPose(poses[p]);
+                    rays += castRays(res.width, &hits[0]);
+                }
+                std::fprintf(runner.log, "%-28s %-22s rays/frame %.1f of %d\n", "", "",
+                             (double)rays / poses.size(), res.width);
+            }
+        }
+    }
+    renderQuality.columnStep = 1;
+    renderQuality.refineSpan = 0;
+}
+
+// Function to measure ray casting for a camera that keeps turning, as with
+// Q/E held down at 30 frames per second
+static void benchTurning(BenchRunner& runner) {
+    static const float TURN_PER_FRAME = 3.14159f / 30.0f;
+    static const char* const NAMES[] = { "raycast.turn", "raycast.turn.angular" };
+    
+    std::vector<ColumnHit> hits;
+    for (int c = 0; c < 2; c++) {
+        if (!runner.selected(NAMES[c])) continue;
+        renderQuality.angularCache = c == 1;
+        for (int m = 0; m < MAP_COUNT; m++) {
+            loadMapCase(MAPS[m]);
+            for (int r = 0; r < RESOLUTION_COUNT; r++) {
+                const Resolution& res = RESOLUTIONS[r];
+                hits.resize(res.width);
+                setPose(poses[0]);
+                runner.run(NAMES[c], std::string(MAPS[m].name) + " " + resName(res), [&]() {
+                    playerA += TURN_PER_FRAME;
+                    castRays(res.width, &hits[0]);
+                });
+                
+                // Rays per turning frame once the turn is under way
+                int rays = 0;
+                for (int f = 0; f < 30; f++) {
+                    playerA += TURN_PER_FRAME;
+                    rays += castRays(res.width, &hits[0]);
+                }
+                std::fprintf(runner.log, "%-28s %-22s rays/frame %.1f of %d\n", "", "", rays / 30.0, res.width);
+            }
+        }
+    }
+    renderQuality.angularCache = false;
+}
+
+static void benchWallsAndFloor(BenchRunner& runner) {
+    loadMapCase(MAPS[0]);
+    setPose(poses[0]);
+    
+    FrameBuffer fb;
+    std::vector<ColumnHit> hits;
+    for (int r = 0; r < RESOLUTION_COUNT; r++) {
+        const Resolution& res = RESOLUTIONS[r];
+        fb.resize(res.width, res.height);
+        hits.resize(res.width);
+        castRays(res.width, &hits[0]);
+        
+        runner.run("walls", resName(res), [&]() { drawWalls(fb, &hits[0]); });
+        renderQuality.texturedWalls = false;
+        runner.run("walls.flat", resName(res), [&]() { drawWalls(fb, &hits[0]); });
+        renderQuality.texturedWalls = true;
+        runner.run("floor", resName(res), [&]() { drawFloor(fb, &hits[0]); });
+        renderQuality.castFloors = false;
+        runner.run("floor.rows", resName(res), [&]() { drawFloor(fb, &hits[0]); });
+        renderQuality.castFloors = true;
+    }
+}
+
+static void benchSprites(BenchRunner& runner) {
+    static const int ENEMY_COUNTS[] = { 3, 32, 256 };
+    
+    FrameBuffer fb;
+    for (int r = 0; r < RESOLUTION_COUNT; r++) {
+        const Resolution& res = RESOLUTIONS[r];
+        fb.resize(res.width, res.height);
+        for (size_t e = 0; e < sizeof(ENEMY_COUNTS) / sizeof(ENEMY_COUNTS[0]); e++) {
+            loadMapCase(MAPS[0]);
+            setPose(poses[0]);
+            populateSprites(ENEMY_COUNTS[e]);
+            
+            char params[64];
+            std::snprintf(params, sizeof(params), "%s e=%d", resName(res).c_str(), ENEMY_COUNTS[e]);
+            runner.run("sprites.enemies", params, [&]() { drawEnemies(fb); });
+            if (e == 0) {
+                runner.run("sprites.bullets", resName(res), [&]() { drawBullets(fb); });
+                runner.run("overlay.minimap_hud", resName(res), [&]() { drawMiniMap(fb); drawHud(fb); });
+            }
+        }
+    }
+}
+
+static void benchMiniMap(BenchRunner& runner) {
+    FrameBuffer fb;
+    fb.resize(SCREEN_WIDTH, SCREEN_HEIGHT);
+    for (int m = 0; m < MAP_COUNT; m++) {
+        loadMapCase(MAPS[m]);
+        setPose(poses[0]);
+        populateSprites(32);
+        
+        // Closest zoom, then the one showing the whole map
+        int zooms[2] = { 0, miniMapZoomLevels() - 1 };
+        for (int z = 0; z < (zooms[1] > 0 ? 2 : 1); z++) {
+            miniMapZoom = zooms[z];
+            char params[64];
+            std::snprintf(params, sizeof(params), "%s zoom=%d", MAPS[m].name, zooms[z]);
+            runner.run("overlay.minimap", params, [&]() { drawMiniMap(fb); });
+        }
+    }
+    miniMapZoom = 0;
+}
+
+static void benchEncode(BenchRunner& runner) {
+    FrameBuffer fb;
+    std::string out;
+    for (int r = 0; r < RESOLUTION_COUNT; r++) {
+        const Resolution& res = RESOLUTIONS[r];
+        loadMapCase(MAPS[0]);
+        setPose(poses[0]);
+        populateSprites(3);
+        fb.resize(res.width, res.height);
+        renderScene(fb);
+        
+        runner.run("encode.ansi", resName(res), [&]() { encodeFrame(fb, out); });
+    }
+}
+
+static void benchUpdateBullets(BenchRunner& runner) {
+    static const int ENEMY_COUNTS[] = { 3, 64, 512 };
+    
+    for (size_t e = 0; e < sizeof(ENEMY_COUNTS) / sizeof(ENEMY_COUNTS[0]); e++) {
+        loadMapCase(MAPS[1]);
+        setPose(poses[0]);
+        populateSprites(ENEMY_COUNTS[e]);
+        
+        // Keep enemies out of the bullets' way so the state is the same every call
+        for (size_t i = 0; i < enemies.size(); i++) {
+            enemies[i].x = 1.5f + (i % 8);
+            enemies[i].y = 1.5f;
+        }
+        indexEnemies();
+        
+        const std::vector<Bullet> initial = bullets;
+        const int initialActive = activeBullets;
+        
+        char params[32];
+        std::snprintf(params, sizeof(params), "e=%d", ENEMY_COUNTS[e]);
+        runner.run("update_bullets", params, [&]() {
+            bullets = initial;
+            activeBullets = initialActive;
+            updateBullets(1.0f / 30.0f);
+        });
+    }
+}
+
+static void benchFrame(BenchRunner& runner) {
+    FrameBuffer fb;
+    for (int m = 0; m < MAP_COUNT; m++) {
+        for (int r = 0; r < RESOLUTION_COUNT; r++) {
+            const Resolution& res = RESOLUTIONS[r];
+            loadMapCase(MAPS[m]);
+            setPose(poses[0]);
+            populateSprites(3);
+            fb.resize(res.width, res.height);
+            
+            // A full frame, then an idle camera that reuses the static layer
+            temporalReuse = false;
+            runner.run("frame", std::string(MAPS[m].name) + " " + resName(res), [&]() { renderScene(fb); });
+            temporalReuse = true;
+            runner.run("frame.idle", std::string(MAPS[m].name) + " " + resName(res), [&]() { renderScene(fb); });
+            
+            // The idle frame sent through the diff presenter, against a full encode
+            if (!runner.selected("frame.idle.present")) continue;
+            PresentedFrame shown;
+            std::string out;
+            runner.run("frame.idle.present", std::string(MAPS[m].name) + " " + resName(res), [&]() {
+                renderScene(fb);
+                encodeFrameDiff(fb, shown, out);
+                fb.dirty.reset(fb.height);
+            });
+            size_t diffBytes = out.size();
+            encodeFrame(fb, out);
+            std::fprintf(runner.log, "%-28s %-22s bytes/frame %zu (full encode %zu)\n", "", "", diffBytes, out.size());
+        }
+    }
+}
+
+// Function to measure looking up every cell of a rendered frame in the G-buffer
+static void benchPick(BenchRunner& runner) {
+    if (!runner.selected("pick")) return;
+    
+    FrameBuffer fb;
+    for (int r = 0; r < RESOLUTION_COUNT; r++) {
+        const Resolution& res = RESOLUTIONS[r];
+        loadMapCase(MAPS[0]);
+        setPose(poses[0]);
+        populateSprites(32);
+        fb.resize(res.width, res.height);
+        renderScene(fb);
+        
+        int enemyCells = 0;
+        runner.run("pick", resName(res), [&]() {
+            enemyCells = 0;
+            for (int y = 0; y < res.height; y++) {
+                for (int x = 0; x < res.width; x++) {
+                    enemyCells += pickCell(x, y).enemy >= 0;
+                }
+            }
+        });
+        std::fprintf(runner.log, "%-28s %-22s cells/op %d (%d on enemies)\n", "", "",
+                     res.width * res.height, enemyCells);
+    }
+}
+
+// Function to add up the prediction counters of every client
+static void predictionTotals(const std::vector<NetClient>& clients, unsigned long& reconciliations, unsigned long& corrections) {
+    reconciliations = corrections = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        reconciliations += clients[i].stats.reconciliations;
+        corrections += clients[i].stats.corrections;
+    }
+}
+
+// Function to measure the authoritative server with players over loopback:
+// one case is a whole tick of every client sending and predicting its
+// input, the server simulating and sending snapshots, and every client
+// decoding and reconciling its own. The full house also runs without
+// interest management, and on a larger generated map where walls and
+// distance hide more of the world.
+static void benchServer(BenchRunner& runner) {
+    struct ServerCase {
+        int players;
+        bool interest;
+        int map; // Into MAPS
+    };
+    static const ServerCase CASES[] = {
+        { 1, true, 0 }, { 8, true, 0 }, { 32, true, 0 }, { 128, true, 0 }, { 128, false, 0 }, { 128, true, 1 }
+    };
+    if (!runner.selected("net.tick")) return;
+    
+    for (size_t k = 0; k < sizeof(CASES) / sizeof(CASES[0]); k++) {
+        const ServerCase& sc = CASES[k];
+        int players = sc.players;
+        GameServer server;
+        std::string error;
+        server.interest = sc.interest;
+        if (!startServer(server, 0, error)) {
+            std::fprintf(runner.log, "net.tick: %s\n", error.c_str());
+            return;
+        }
+        if (sc.map > 0) loadMapCase(MAPS[sc.map]);
+        NetAddress address(0x7F000001, boundPort(server.socket));
+        std::vector<NetClient> clients(players);
+        for (int i = 0; i < players; i++) {
+            if (!startClient(clients[i], address, error)) {
+                std::fprintf(runner.log, "net.tick: %s\n", error.c_str());
+                return;
+            }
+        }
+        
+        auto tick = [&]() {
+            for (int i = 0; i < players; i++) {
+                clients[i].pending = scriptedInput(i, server.tick);
+                sendInput(clients[i]);
+            }
+            serverTick(server);
+            for (int i = 0; i < players; i++) {
+                pollClient(clients[i]);
+            }
+        };
+        
+        // Everyone joins, the deltas settle and every client's view history
+        // fills before timing
+        for (int t = 0; t < NET_TICK_RATE + SNAPSHOT_HISTORY; t++) tick();
+        
+        ServerStats before = server.stats;
+        unsigned long reconciledBefore, correctedBefore;
+        predictionTotals(clients, reconciledBefore, correctedBefore);
+        char params[48];
+        int length = std::snprintf(params, sizeof(params), "players=%d", players);
+        if (!sc.interest) std::snprintf(params + length, sizeof(params) - length, " interest=off");
+        if (sc.map > 0) std::snprintf(params + length, sizeof(params) - length, " map=%s", MAPS[sc.map].name);
+        runner.run("net.tick", params, tick);
+        
+        const ServerStats& after = server.stats;
+        double ticks = (double)(after.ticks - before.ticks);
+        double bytesPerClient = (after.snapshotBytes - before.snapshotBytes) / ticks / players;
+        std::fprintf(runner.log, "%-28s %-22s server tick %.1f us, %.0f B/tick per client (%.1f KB/s), %.2f encodes/tick, %lu full\n",
+                     "", "", (after.tickMs - before.tickMs) * 1000.0 / ticks, bytesPerClient,
+                     bytesPerClient * NET_TICK_RATE / 1024.0, (after.encodes - before.encodes) / ticks,
+                     after.fullSnapshots - before.fullSnapshots);
+        if (sc.interest) {
+            const InterestCounts& a = after.interest;
+            const InterestCounts& b = before.interest;
+            double views = (double)(after.snapshots - before.snapshots);
+            std::fprintf(runner.log, "%-28s %-22s entities per client per tick: %.1f sent, %.1f held, %.1f capped of %.1f relevant, %.1f culled\n",
+                         "", "", (a.sent - b.sent) / views, (a.held - b.held) / views, (a.capped - b.capped) / views,
+                         (a.relevant - b.relevant) / views, (a.culled - b.culled) / views);
+        }
+        unsigned long reconciled, corrected;
+        predictionTotals(clients, reconciled, corrected);
+        std::fprintf(runner.log, "%-28s %-22s %lu of %lu predictions corrected\n", "", "",
+                     corrected - correctedBefore, reconciled - reconciledBefore);
+        
+        for (int i = 0; i < players; i++) stopClient(clients[i]);
+        stopServer(server);
+    }
+}
+
+#ifdef __unix__
+// Function to open a loopback connection that reads like a viewer, -1 on failure
+static int connectViewer(unsigned short port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && fcntl(fd, F_SETFL, O_NONBLOCK) == 0) return fd;
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+// Function to measure streaming frames to viewers over loopback: one case
+// is a turning camera's frame rendered, broadcast, and read by every viewer
+static void benchSpectate(BenchRunner& runner) {
+    static const int VIEWER_COUNTS[] = { 1, 100, 500 };
+    if (!runner.selected("spectate.frame")) return;
+    
+    FrameBuffer fb;
+    std::vector<char> sink(1 << 16);
+    for (size_t v = 0; v < sizeof(VIEWER_COUNTS) / sizeof(VIEWER_COUNTS[0]); v++) {
+        int viewerCount = VIEWER_COUNTS[v];
+        SpectatorServer spectators;
+        std::string error;
+        if (!startSpectators(spectators, 0, error)) {
+            std::fprintf(runner.log, "spectate.frame: %s\n", error.c_str());
+            return;
+        }
+        loadMapCase(MAPS[0]);
+        setPose(poses[0]);
+        populateSprites(3);
+        fb.resize(SCREEN_WIDTH, SCREEN_HEIGHT);
+        std::vector<int> viewers;
+        auto frame = [&]() {
+            playerA += 0.02f;
+            renderScene(fb);
+            broadcastFrame(spectators, fb);
+            fb.dirty.reset(fb.height);
+            for (size_t i = 0; i < viewers.size(); i++) {
+                while (read(viewers[i], &sink[0], sink.size()) > 0) {
+                }
+            }
+        };
+        
+        // Everyone joins and gets a keyframe before timing; connections are
+        // taken in between so the listen queue never fills
+        for (int i = 0; i < viewerCount; i++) {
+            int fd = connectViewer(spectatorPort(spectators));
+            if (fd >= 0) viewers.push_back(fd);
+            if (i % 64 == 63) frame();
+        }
+        for (int i = 0; i < 10; i++) frame();
+        
+        SpectatorStats before = spectators.stats;
+        char params[32];
+        std::snprintf(params, sizeof(params), "viewers=%d", (int)viewers.size());
+        runner.run("spectate.frame", params, frame);
+        
+        const SpectatorStats& after = spectators.stats;
+        double frames = (double)(after.frames - before.frames);
+        std::fprintf(runner.log, "%-28s %-22s broadcast %.1f us/frame, %.0f B/frame per viewer, %.1f writes/frame, %lu keyframes, %lu resyncs\n",
+                     "", "", (after.broadcastMs - before.broadcastMs) * 1000.0 / frames,
+                     (after.bytesSent - before.bytesSent) / frames / viewers.size(), (after.writes - before.writes) / frames,
+                     after.keyframes - before.keyframes, after.resyncs - before.resyncs);
+        
+        for (size_t i = 0; i < viewers.size(); i++) close(viewers[i]);
+        stopSpectators(spectators);
+    }
+}
+#else
+static void benchSpectate(BenchRunner&) {
+}
+#endif
+
+static void usage(const char* argv0) {
+    std::printf("usage: %s [options]\n"
+                "  --filter NAME   only run benchmarks whose name contains NAME\n"
+                "  --warmup N      untimed repetitions (default 3)\n"
+                "  --reps N        timed repetitions (default 15)\n"
+                "  --min-ms MS     minimum duration of one repetition (default 5)\n"
+                "  --json FILE     write results as JSON to FILE ('-' for stdout)\n"
+                "  --perf          read hardware performance counters (Linux)\n"
+                "  --verify        check rendered frames against the golden frames instead of timing\n"
+                "  --update-golden rewrite the golden frames from the current renderer\n"
+                "  --golden-dir D  golden frame directory (default %s)\n"
+                "  --replay FILE   replay checked for steady-state allocations (default %s)\n"
+                "  --tolerant      allow glyphs shifted by a cell and up to 1%% mismatched cells\n", argv0, FPS_GOLDEN_DIR,
+                FPS_VERIFY_REPLAY);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    VerifyOptions verify;
+    verify.goldenDir = FPS_GOLDEN_DIR;
+    verify.replayPath = FPS_VERIFY_REPLAY;
+    bool verifyMode = false;
+    bool perf = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) options.filter = argv[++i];
+        else if (arg == "--warmup" && hasValue) options.warmup = std::atoi(argv[++i]);
+        else if (arg == "--reps" && hasValue) options.reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-ms" && hasValue) options.minRepMs = std::atof(argv[++i]);
+        else if (arg == "--json" && hasValue) options.jsonPath = argv[++i];
+        else if (arg == "--perf") perf = true;
+        else if (arg == "--verify") verifyMode = true;
+        else if (arg == "--update-golden") verifyMode = verify.update = true;
+        else if (arg == "--golden-dir" && hasValue) verify.goldenDir = argv[++i];
+        else if (arg == "--replay" && hasValue) verify.replayPath = argv[++i];
+        else if (arg == "--tolerant") verify.compare.mode = COMPARE_TOLERANT;
+        else {
+            usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    
+    // The bullet code prints debug output to the terminal, keep it quiet here
+    debugOutput = false;
+    
+    if (verifyMode) {
+        return runVerify(verify) == 0 ? 0 : 1;
+    }
+    
+    std::string perfError;
+    if (perf && !openPerfCounters(perfError)) {
+        std::fprintf(stderr, "hardware counters unavailable, continuing without: %s\n", perfError.c_str());
+    }
+    
+    BenchRunner runner(options);
+    if (options.jsonPath == "-") runner.log = stderr;
+    
+    runner.printHeader();
+    benchRaycast(runner);
+    benchTurning(runner);
+    benchWallsAndFloor(runner);
+    benchSprites(runner);
+    benchMiniMap(runner);
+    benchEncode(runner);
+    benchUpdateBullets(runner);
+    benchFrame(runner);
+    benchPick(runner);
+    benchServer(runner);
+    benchSpectate(runner);
+    
+    if (!options.jsonPath.empty()) {
+        FILE* out = options.jsonPath == "-" ? stdout : std::fopen(options.jsonPath.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "Could not open %s for writing\n", options.jsonPath.c_str());
+            return 1;
+        }
+        runner.writeJson(out);
+        if (out != stdout) std::fclose(out);
+    }
+    
+    closePerfCounters();
+    
+    return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "alloc_track.h"
+#include "perf_counters.h"
+
+// Command line settings shared by every benchmark
+struct BenchOptions {
+    int warmup;            // Untimed repetitions before measuring
+    int reps;              // Timed repetitions
+    double minRepMs;       // Each repetition runs at least this long
+    std::string filter;    // Only run benchmarks whose name contains this
+    std::string jsonPath;  // Write results as JSON here ("-" for stdout)
+    
+    BenchOptions() : warmup(3), reps(15), minRepMs(5.0) {}
+};
+
+// Summary of the per-iteration times of one benchmark, in nanoseconds
+struct BenchStats {
+    double mean, median, stddev, min, max, p95;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string params;
+    long iterations;   // Iterations per repetition
+    BenchStats ns;
+    double allocsPerOp;     // Heap allocations per iteration
+    double allocBytesPerOp; // Bytes allocated per iteration
+    double perfPerOp[PERF_COUNTER_COUNT]; // Hardware counters per iteration (0 when unavailable)
+};
+
+// Function to summarise a set of samples
+inline BenchStats summarise(std::vector<double> samples) {
+    BenchStats s = { 0, 0, 0, 0, 0, 0 };
+    if (samples.empty()) return s;
+    
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += samples[i];
+    s.mean = sum / n;
+    
+    double var = 0.0;
+    for (size_t i = 0; i < n; i++) var += (samples[i] - s.mean) * (samples[i] - s.mean);
+    s.stddev = n > 1 ? std::sqrt(var / (n - 1)) : 0.0;
+    
+    s.median = (n % 2) ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    s.min = samples.front();
+    s.max = samples.back();
+    s.p95 = samples[std::min(n - 1, (size_t)std::ceil(0.95 * n) - 1)];
+    return s;
+}
+
+// Runs benchmark bodies and collects their results
+struct BenchRunner {
+    BenchOptions options;
+    std::vector<BenchResult> results;
+    FILE* log;         // Where the human readable table goes
+    
+    explicit BenchRunner(const BenchOptions& opts) : options(opts), log(stdout) {}
+    
+    bool selected(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+    
+    // Time fn(): warm up, pick an iteration count that fills minRepMs,
+    // then record the mean time per iteration of every repetition.
+    template <typename Fn>
+    void run(const std::string& name, const std::string& params, Fn fn) {
+        if (!selected(name)) return;
+        typedef std::chrono::steady_clock Clock;
+        
+        for (int i = 0; i < options.warmup; i++) fn();
+        
+        // Calibrate iterations per repetition
+        long iterations = 1;
+        for (;;) {
+            Clock::time_point t0 = Clock::now();
+            for (long i = 0; i < iterations; i++) fn();
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            if (ms >= options.minRepMs || iterations >= (1L << 24)) break;
+            iterations = ms <= 0.0 ? iterations * 10 : std::max(iterations + 1, (long)(iterations * options.minRepMs / ms * 1.2));
+        }
+        
+        std::vector<double> samples;
+        samples.reserve(options.reps);
+        AllocCounters allocsBefore = allocationTotals();
+        PerfSample perfBefore, perfAfter;
+        readPerfCounters(perfBefore);
+        for (int r = 0; r < options.reps; r++) {
+            Clock::time_point t0 = Clock::now();
+            for (long i = 0; i < iterations; i++) fn();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+            samples.push_back(ns / iterations);
+        }
+        readPerfCounters(perfAfter);
+        AllocCounters allocsAfter = allocationTotals();
+        double ops = (double)iterations * options.reps;
+        
+        BenchResult result;
+        result.name = name;
+        result.params = params;
+        result.iterations = iterations;
+        result.ns = summarise(samples);
+        result.allocsPerOp = (allocsAfter.count - allocsBefore.count) / ops;
+        result.allocBytesPerOp = (allocsAfter.bytes - allocsBefore.bytes) / ops;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            result.perfPerOp[c] = perfDelta(perfBefore, perfAfter, c) / ops;
+        }
+        results.push_back(result);
+        
+        std::fprintf(log, "%-28s %-22s %12.1f %12.1f %10.1f %12.1f %10.2f\n", name.c_str(), params.c_str(),
+                    result.ns.median, result.ns.mean, result.ns.stddev, result.ns.p95, result.allocsPerOp);
+        if (perfCountersEnabled) {
+            const double* perf = result.perfPerOp;
+            double instructions = perf[PERF_INSTRUCTIONS];
+            std::fprintf(log, "%-28s %-22s cycles/op %.0f  IPC %.2f  cache miss/kI %.2f  branch miss/kI %.2f\n", "", "",
+                         perf[PERF_CYCLES], perf[PERF_CYCLES] > 0 ? instructions / perf[PERF_CYCLES] : 0.0,
+                         instructions > 0 ? perf[PERF_CACHE_MISSES] * 1000.0 / instructions : 0.0,
+                         instructions > 0 ? perf[PERF_BRANCH_MISSES] * 1000.0 / instructions : 0.0);
+        }
+        std::fflush(log);
+    }
+    
+    void printHeader() const {
+        std::fprintf(log, "%-28s %-22s %12s %12s %10s %12s %10s\n", "benchmark", "params",
+                    "median ns", "mean ns", "stddev", "p95 ns", "allocs/op");
+    }
+    
+    void writeJson(FILE* out) const {
+        std::fprintf(out, "{\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [\n", options.warmup, options.reps);
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            std::fprintf(out, "    {\"name\": \"%s\", \"params\": \"%s\", \"iterations\": %ld, "
+                         "\"ns_per_op\": {\"mean\": %.2f, \"median\": %.2f, \"stddev\": %.2f, "
+                         "\"min\": %.2f, \"max\": %.2f, \"p95\": %.2f}, "
+                         "\"allocs_per_op\": %.3f, \"alloc_bytes_per_op\": %.1f",
+                         r.name.c_str(), r.params.c_str(), r.iterations,
+                         r.ns.mean, r.ns.median, r.ns.stddev, r.ns.min, r.ns.max, r.ns.p95,
+                         r.allocsPerOp, r.allocBytesPerOp);
+            if (perfCountersEnabled) {
+                double instructions = r.perfPerOp[PERF_INSTRUCTIONS];
+                std::fprintf(out, ", \"perf_per_op\": {\"cycles\": %.1f, \"instructions\": %.1f, "
+                             "\"cache_misses\": %.3f, \"branch_misses\": %.3f, \"ipc\": %.3f}",
+                             r.perfPerOp[PERF_CYCLES], instructions, r.perfPerOp[PERF_CACHE_MISSES],
+                             r.perfPerOp[PERF_BRANCH_MISSES],
+                             r.perfPerOp[PERF_CYCLES] > 0 ? instructions / r.perfPerOp[PERF_CYCLES] : 0.0);
+            }
+            std::fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+};
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,90 @@
+#include "scenes.h"
+
+#include "game.h"
+
+#include <cmath>
+#include <cstdio>
+
+const Resolution RESOLUTIONS[] = { { 80, 24 }, { 120, 40 }, { 240, 80 } };
+const int RESOLUTION_COUNT = sizeof(RESOLUTIONS) / sizeof(RESOLUTIONS[0]);
+
+const MapCase MAPS[] = { { "default", 0 }, { "gen64", 64 }, { "gen256", 256 } };
+const int MAP_COUNT = sizeof(MAPS) / sizeof(MAPS[0]);
+
+std::vector<Pose> poses;
+
+// Function to clear a 3x3 block around a cell so a pose never starts inside a wall
+static void clearAround(int cx, int cy) {
+    for (int y = cy - 1; y <= cy + 1; y++) {
+        for (int x = cx - 1; x <= cx + 1; x++) {
+            if (x > 0 && y > 0 && x < mapWidth - 1 && y < mapHeight - 1) {
+                map[y * mapWidth + x] = '.';
+            }
+        }
+    }
+    mapVersion++;
+}
+
+// Function to load a benchmark map and the fixed poses used on it
+void loadMapCase(const MapCase& mc) {
+    initWorld();
+    if (mc.size > 0) {
+        generateMap(mc.size, mc.size, 0x5eed0000u + mc.size);
+    }
+    
+    poses.clear();
+    Pose p0 = { mapWidth * 0.5f + 0.5f, mapHeight * 0.5f + 0.5f, 0.3f };
+    Pose p1 = { mapWidth * 0.25f + 0.5f, mapHeight * 0.25f + 0.5f, 2.2f };
+    Pose p2 = { mapWidth * 0.75f + 0.5f, mapHeight * 0.5f + 0.5f, -1.1f };
+    poses.push_back(p0);
+    poses.push_back(p1);
+    poses.push_back(p2);
+    
+    if (mc.size > 0) {
+        for (size_t i = 0; i < poses.size(); i++) {
+            clearAround((int)poses[i].x, (int)poses[i].y);
+        }
+    }
+}
+
+// Function to move the player to a pose
+void setPose(const Pose& p) {
+    playerX = p.x;
+    playerY = p.y;
+    playerA = p.a;
+}
+
+// Function to surround the current pose with enemies and in-flight bullets
+void populateSprites(int enemyCount) {
+    enemies.clear();
+    // Spread enemies all around the player so some are always on screen
+    for (int i = 0; i < enemyCount; i++) {
+        float angle = playerA + i * 6.2831853f / enemyCount;
+        float dist = 1.5f + (i % 7) * 0.9f;
+        enemies.push_back(Enemy(playerX + sinf(angle) * dist, playerY + cosf(angle) * dist));
+    }
+    indexEnemies();
+    
+    activeBullets = 0;
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        Bullet& b = bullets[i];
+        float angle = playerA + (i - MAX_BULLETS / 2) * 0.06f;
+        b.dx = sinf(angle) * bulletSpeed;
+        b.dy = cosf(angle) * bulletSpeed;
+        b.x = playerX + sinf(angle) * (0.5f + i * 0.3f);
+        b.y = playerY + cosf(angle) * (0.5f + i * 0.3f);
+        for (int t = 0; t < BULLET_TRAIL_LENGTH; t++) {
+            b.trailX[t] = b.x - sinf(angle) * 0.1f * t;
+            b.trailY[t] = b.y - cosf(angle) * 0.1f * t;
+        }
+        b.active = true;
+        activeBullets++;
+    }
+}
+
+// Function to format a resolution as WxH
+std::string resName(const Resolution& r) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%dx%d", r.width, r.height);
+    return buf;
+}
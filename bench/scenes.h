@@ -0,0 +1,43 @@
+#ifndef BENCH_SCENES_H
+#define BENCH_SCENES_H
+
+#include <string>
+#include <vector>
+
+// Fixed scenes shared by the benchmarks and the golden-frame checks
+
+struct Resolution {
+    int width, height;
+};
+
+struct Pose {
+    float x, y, a;
+};
+
+struct MapCase {
+    const char* name;
+    int size; // 0 = built-in map
+};
+
+extern const Resolution RESOLUTIONS[];
+extern const int RESOLUTION_COUNT;
+
+extern const MapCase MAPS[];
+extern const int MAP_COUNT;
+
+// Camera poses for the map loaded by loadMapCase()
+extern std::vector<Pose> poses;
+
+// Function to load a benchmark map and the fixed poses used on it
+void loadMapCase(const MapCase& mc);
+
+// Function to move the player to a pose
+void setPose(const Pose& p);
+
+// Function to surround the current pose with enemies and in-flight bullets
+void populateSprites(int enemyCount);
+
+// Function to format a resolution as WxH
+std::string resName(const Resolution& r);
+
+#endif // BENCH_SCENES_H
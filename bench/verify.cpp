@@ -0,0 +1,476 @@
+#include "verify.h"
+#include "scenes.h"
+
+#include "bots.h"
+#include "client.h"
+#include "game.h"
+#include "governor.h"
+#include "present.h"
+#include "profile.h"
+#include "render.h"
+#include "replay.h"
+#include "server.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// An optimised render path that must produce the same picture as the
+// reference renderer. enable(true) switches it on, enable(false) back off.
+struct RenderVariant {
+    const char* name;
+    void (*enable)(bool on);
+    CompareOptions compare;
+    int warmFrames;  // Frames rendered before the compared one (for caches)
+    float warmTurn;  // How far the camera turns between warm-up frames, ending on the compared pose
+};
+
+// Functions to cast rays for every 2nd or 3rd column only
+static void enableHalfColumns(bool on) { renderQuality.columnStep = on ? 2 : 1; }
+static void enableThirdColumns(bool on) { renderQuality.columnStep = on ? 3 : 1; }
+
+// Function to cast sparse rays and refine only around edges
+static void enableRefinedColumns(bool on) { renderQuality.refineSpan = on ? 8 : 0; }
+
+// Function to reuse the static layer of the previous frame
+static void enableTemporalReuse(bool on) { temporalReuse = on; }
+
+// Function to take rays from the angular cache
+static void enableAngularCache(bool on) { renderQuality.angularCache = on; }
+
+// Function to list the optimised render paths to check
+static std::vector<RenderVariant> renderVariants() {
+    std::vector<RenderVariant> variants;
+    
+    // Reconstructed columns are allowed to land a cell off at wall edges
+    CompareOptions reconstructed;
+    reconstructed.mode = COMPARE_TOLERANT;
+    reconstructed.neighbourhood = 1;
+    reconstructed.maxMismatchFraction = 0.02;
+    RenderVariant half = { "columns/2", enableHalfColumns, reconstructed, 0, 0.0f };
+    RenderVariant third = { "columns/3", enableThirdColumns, reconstructed, 0, 0.0f };
+    variants.push_back(half);
+    variants.push_back(third);
+    
+    // Refined columns match exactly unless a pillar hides between two sparse rays
+    CompareOptions refined;
+    refined.mode = COMPARE_TOLERANT;
+    refined.neighbourhood = 1;
+    refined.maxMismatchFraction = 0.002;
+    RenderVariant edges = { "columns/refine", enableRefinedColumns, refined, 0, 0.0f };
+    variants.push_back(edges);
+    
+    // A repeated frame must come out of the static layer exactly as cast
+    CompareOptions exact;
+    exact.mode = COMPARE_EXACT;
+    RenderVariant temporal = { "temporal", enableTemporalReuse, exact, 1, 0.0f };
+    variants.push_back(temporal);
+    
+    // Turning onto the pose reuses most rays; snapping to whole columns may
+    // move an edge by one cell
+    CompareOptions snapped;
+    snapped.mode = COMPARE_TOLERANT;
+    snapped.neighbourhood = 1;
+    snapped.maxMismatchFraction = 0.01;
+    RenderVariant angular = { "angular", enableAngularCache, snapped, 3, 0.1f };
+    variants.push_back(angular);
+    return variants;
+}
+
+// Scenes covered by the golden frames: two maps, every pose, two sizes
+static const int GOLDEN_MAPS = 2;
+static const int GOLDEN_SIZES = 2;
+static const int GOLDEN_ENEMIES = 6;
+
+// Quality levels checked in open space
+static const int OPEN_SPACE_FIRST_LEVEL = 4;
+
+// Frames of a replay allowed to allocate while buffers and caches warm up,
+// as with the game's --assert-no-alloc
+static const int REPLAY_WARMUP_FRAMES = 60;
+
+// Frames spent at each quality level when a replay steps through them all
+static const int REPLAY_LEVEL_FRAMES = 20;
+
+// Level argument of checkReplayAllocations for warming up at full detail
+// and stepping down through the other levels after warm-up, the way the
+// governor does under load
+static const int REPLAY_ALL_LEVELS = -1;
+
+// Function to render a scene, running the warm-up frames first
+static void renderWarm(FrameBuffer& fb, int warmFrames, float warmTurn) {
+    float angle = playerA;
+    for (int i = 0; i < warmFrames; i++) {
+        playerA = angle - warmTurn * (warmFrames - i);
+        renderScene(fb);
+    }
+    playerA = angle;
+    renderScene(fb);
+}
+
+// Function to check a rendered frame against its golden frame, or write it
+// as the new golden frame; returns false on a failure
+static bool checkGolden(const VerifyOptions& options, const char* name, const FrameBuffer& frame, int& checked) {
+    std::string path = options.goldenDir + "/" + name + ".txt";
+    if (options.update) {
+        if (!saveFrame(path, frame, name)) {
+            std::printf("FAIL %s: cannot write %s\n", name, path.c_str());
+            return false;
+        }
+        std::printf("wrote %s\n", path.c_str());
+        return true;
+    }
+    
+    FrameBuffer golden;
+    std::string error;
+    checked++;
+    if (!loadFrame(path, golden, error)) {
+        std::printf("FAIL %s: %s\n", name, error.c_str());
+        return false;
+    }
+    CompareResult result = compareFrames(golden, frame, options.compare);
+    if (!result.match) {
+        std::printf("FAIL %s: %d cells differ from the golden frame\n%s", name, result.mismatches,
+                    describeFrameDiff(golden, frame, 8).c_str());
+        return false;
+    }
+    std::printf("ok   %s (%d cells forgiven)\n", name, result.forgiven);
+    return true;
+}
+
+// Function to load a map with nothing but its border walls and no sprites,
+// where most rays run out at the view distance without hitting anything
+static void loadOpenMap(int size) {
+    initWorld();
+    enemies.clear();
+    mapWidth = size;
+    mapHeight = size;
+    map.assign(size * size, '.');
+    for (int i = 0; i < size; i++) {
+        map[i] = map[(size - 1) * size + i] = '#';
+        map[i * size] = map[i * size + size - 1] = '#';
+    }
+    mapVersion++;
+    indexEnemies();
+}
+
+// Function to play a replay back at one size and quality level the way the
+// headless game does, checking that no frame past warm-up allocates;
+// returns false on a failure
+static bool checkReplayAllocations(const Replay& replay, const Resolution& res, int level, int& checked) {
+    initWorld();
+    applyQualityLevel(std::max(level, 0));
+    const float elapsedTime = 1.0f / 30.0f;
+    FrameBuffer frame;
+    frame.resize(res.width, res.height);
+    std::string encoded;
+    checked++;
+    
+    char name[96];
+    if (level == REPLAY_ALL_LEVELS) {
+        std::snprintf(name, sizeof(name), "replay-levels-%s", resName(res).c_str());
+    } else {
+        std::snprintf(name, sizeof(name), "replay-q%d-%s", level, resName(res).c_str());
+    }
+    bool allocated = false;
+    for (size_t f = 0; f < replay.frames.size() && !allocated; f++) {
+        beginFrameStats((long)f);
+        if (level == REPLAY_ALL_LEVELS && (int)f >= REPLAY_WARMUP_FRAMES) {
+            int steps = ((int)f - REPLAY_WARMUP_FRAMES) / REPLAY_LEVEL_FRAMES + 1;
+            applyQualityLevel(steps % QUALITY_LEVEL_COUNT);
+        }
+        {
+            StageTimer timer(STAGE_INPUT);
+            const std::string& keys = replay.frames[f];
+            for (size_t k = 0; k < keys.size(); k++) applyKey(keys[k], elapsedTime);
+        }
+        {
+            StageTimer timer(STAGE_UPDATE);
+            updateBullets(elapsedTime);
+        }
+        renderScene(frame);
+        {
+            StageTimer timer(STAGE_ENCODE);
+            encodeFrame(frame, encoded);
+        }
+        endFrameStats(0.0);
+        
+        if (currentFrame.frame < REPLAY_WARMUP_FRAMES || currentFrame.allocations == 0) continue;
+        std::printf("FAIL %s: frame %ld allocated %lu times after warm-up:", name, currentFrame.frame,
+                    currentFrame.allocations);
+        for (int i = 0; i <= STAGE_COUNT; i++) {
+            if (currentFrame.stageAllocs[i] > 0) {
+                std::printf(" %s=%lu", i < STAGE_COUNT ? stageName((Stage)i) : "other", currentFrame.stageAllocs[i]);
+            }
+        }
+        std::printf("\n");
+        allocated = true;
+    }
+    applyQualityLevel(0);
+    if (!allocated) std::printf("ok   %s (%d frames)\n", name, (int)replay.frames.size());
+    return !allocated;
+}
+
+// Clients of the interest check, each with its own loss pattern; the first
+// few lose nothing
+static const int VIEW_CHECK_CLIENTS = 24;
+static const int VIEW_CHECK_LOSSLESS = 3;
+static const unsigned int VIEW_CHECK_TICKS = NET_TICK_RATE * 20;
+
+// Function to make an entity from world units
+static EntityState entityAt(unsigned int id, EntityKind kind, float x, float y, float angle) {
+    EntityState e = { id, (unsigned char)kind, quantizePosition(x), quantizePosition(y), quantizeAngle(angle) };
+    return e;
+}
+
+// Function to check that two snapshots hold the same entities, field by field
+static bool sameEntities(const Snapshot& a, const Snapshot& b) {
+    if (a.entities.size() != b.entities.size()) return false;
+    for (size_t i = 0; i < a.entities.size(); i++) {
+        const EntityState& x = a.entities[i];
+        const EntityState& y = b.entities[i];
+        if (x.id != y.id || x.kind != y.kind || x.x != y.x || x.y != y.y || x.angle != y.angle) return false;
+    }
+    return true;
+}
+
+// Function to encode a snapshot against a base, decode it against the same
+// base and check that the decoded snapshot is the one encoded; returns
+// false on a failure
+static bool checkSnapshotRoundTrip(const char* name, const Snapshot* base, const Snapshot& current, int& checked) {
+    PacketWriter w;
+    encodeSnapshotDelta(base, current, w);
+    PacketReader r(&w.data[0], w.size());
+    Snapshot decoded;
+    bool ok = decodeSnapshotDelta(base, r, decoded);
+    checked++;
+    if (!ok || !r.atEnd() || !sameEntities(decoded, current)) {
+        std::printf("FAIL snapshot.delta %s: %s\n", name, !ok ? "malformed" : !r.atEnd() ? "bytes left over" : "decoded a different world");
+        return false;
+    }
+    std::printf("ok   snapshot.delta %s (%d bytes)\n", name, w.size());
+    return true;
+}
+
+// Function to round-trip snapshot deltas with entities added, removed,
+// changed and unchanged, and with fields that wrap; returns the number of
+// failures
+static int checkSnapshotCodec(int& checked) {
+    Snapshot base;
+    base.tick = 10;
+    base.entities.push_back(entityAt(playerEntityId(0), ENTITY_PLAYER, 3.5f, 4.5f, 0.2f));
+    base.entities.push_back(entityAt(playerEntityId(1), ENTITY_PLAYER, 12.0f, 7.25f, -1.0f));
+    base.entities.push_back(entityAt(bulletEntityId(0, 2), ENTITY_BULLET, 5.0f, 5.0f, 0.0f));
+    base.entities.push_back(entityAt(enemyEntityId(0), ENTITY_ENEMY, 20.0f, 20.0f, 3.1f));
+    base.entities.push_back(entityAt(enemyEntityId(40), ENTITY_ENEMY, 0.5f, 250.0f, -0.001f));
+    
+    // Player 0 moves, player 1 stands still, the bullet is gone, another
+    // appears, one enemy turns past pi and the other past zero and jumps
+    // across the map
+    Snapshot current;
+    current.tick = 11;
+    current.entities.push_back(entityAt(playerEntityId(0), ENTITY_PLAYER, 3.75f, 4.25f, 0.2f));
+    current.entities.push_back(base.entities[1]);
+    current.entities.push_back(entityAt(bulletEntityId(1, 0), ENTITY_BULLET, 12.5f, 7.5f, 0.0f));
+    current.entities.push_back(entityAt(enemyEntityId(0), ENTITY_ENEMY, 20.0f, 20.0f, -3.1f));
+    current.entities.push_back(entityAt(enemyEntityId(40), ENTITY_ENEMY, 255.5f, 0.5f, 0.001f));
+    
+    Snapshot empty;
+    empty.tick = 12;
+    
+    int failures = 0;
+    if (!checkSnapshotRoundTrip("full", NULL, current, checked)) failures++;
+    if (!checkSnapshotRoundTrip("changes", &base, current, checked)) failures++;
+    if (!checkSnapshotRoundTrip("reverse", &current, base, checked)) failures++;
+    if (!checkSnapshotRoundTrip("unchanged", &base, base, checked)) failures++;
+    if (!checkSnapshotRoundTrip("all-removed", &base, empty, checked)) failures++;
+    if (!checkSnapshotRoundTrip("all-added", &empty, base, checked)) failures++;
+    return failures;
+}
+
+// Function to run a server with interest management and clients that lose
+// inputs and snapshots, checking that every snapshot a client decodes is
+// exactly the view the server recorded for it at that tick and holds the
+// client's own player, and that clients losing nothing decode one every
+// tick; returns false on a failure
+static bool checkInterestViews(int budget, int& checked) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "net.views budget=%d", budget);
+    GameServer server;
+    server.snapshotBudget = budget;
+    std::string error;
+    if (!startServer(server, 0, error)) {
+        std::printf("skip %s: %s\n", name, error.c_str());
+        return true;
+    }
+    NetAddress address(0x7F000001, boundPort(server.socket));
+    std::vector<NetClient> clients(VIEW_CHECK_CLIENTS);
+    for (int i = 0; i < VIEW_CHECK_CLIENTS; i++) {
+        if (!startClient(clients[i], address, error)) {
+            std::printf("skip %s: %s\n", name, error.c_str());
+            stopServer(server);
+            return true;
+        }
+    }
+    
+    checked++;
+    unsigned long compared = 0;
+    const char* problem = NULL;
+    std::vector<unsigned char> drained(65536);
+    for (unsigned int t = 1; t <= VIEW_CHECK_TICKS && !problem; t++) {
+        for (int i = 0; i < VIEW_CHECK_CLIENTS; i++) {
+            NetClient& c = clients[i];
+            c.pending = scriptedInput(i, t);
+            
+            // Every odd client loses a quarter of its inputs, sent to a dead port
+            NetAddress server = c.server;
+            if (i % 2 == 1 && (t + i) % 4 == 0) c.server.port = 1;
+            sendInput(c);
+            c.server = server;
+        }
+        serverTick(server);
+        
+        for (int i = 0; i < VIEW_CHECK_CLIENTS && !problem; i++) {
+            NetClient& c = clients[i];
+            if (i >= VIEW_CHECK_LOSSLESS && (t * 7 + i) % 3 == 0) {
+                // A third of the snapshots never arrive
+                NetAddress from;
+                while (receivePacket(c.socket, from, &drained[0], (int)drained.size()) >= 0) {}
+                continue;
+            }
+            if (pollClient(c) == 0) {
+                // A snapshot goes out every tick, and one that cannot be decoded is dropped
+                if (i < VIEW_CHECK_LOSSLESS && c.latestTick != 0) problem = "a client that loses nothing decoded no snapshot";
+                continue;
+            }
+            
+            const Snapshot* decoded = latestSnapshot(c);
+            const Snapshot* view = server.clients[c.slot].interest.views.find(decoded->tick);
+            if (!view) {
+                problem = "decoded a tick the server has no view of";
+            } else if (!sameEntities(*decoded, *view)) {
+                problem = "decoded a snapshot that differs from the server's view";
+            } else if (!findEntity(*decoded, playerEntityId(c.slot))) {
+                problem = "snapshot lacks the client's own player";
+            }
+            compared++;
+        }
+    }
+    
+    for (int i = 0; i < VIEW_CHECK_CLIENTS; i++) stopClient(clients[i]);
+    const InterestCounts& counts = server.stats.interest;
+    if (!problem && compared == 0) problem = "no snapshot was decoded";
+    if (problem) {
+        std::printf("FAIL %s: %s\n", name, problem);
+    } else {
+        std::printf("ok   %s (%lu snapshots, %lu sent, %lu held, %lu capped)\n", name, compared, counts.sent,
+                    counts.held, counts.capped);
+    }
+    stopServer(server);
+    return problem == NULL;
+}
+
+// Function to render the fixed scenes and check them
+int runVerify(const VerifyOptions& options) {
+    std::vector<RenderVariant> variants = renderVariants();
+    // The reference render casts every frame; reuse is checked as a variant
+    bool reuse = temporalReuse;
+    temporalReuse = false;
+    int failures = 0;
+    int checked = 0;
+    
+    FrameBuffer reference, actual;
+    for (int m = 0; m < GOLDEN_MAPS; m++) {
+        for (int r = 0; r < GOLDEN_SIZES; r++) {
+            const Resolution& res = RESOLUTIONS[r];
+            loadMapCase(MAPS[m]);
+            
+            for (size_t p = 0; p < poses.size(); p++) {
+                char name[96];
+                std::snprintf(name, sizeof(name), "%s-p%d-%s", MAPS[m].name, (int)p, resName(res).c_str());
+                
+                setPose(poses[p]);
+                populateSprites(GOLDEN_ENEMIES);
+                reference.resize(res.width, res.height);
+                renderScene(reference);
+                if (!checkGolden(options, name, reference, checked)) failures++;
+                
+                // Optimised paths are checked against the reference render
+                for (size_t v = 0; v < variants.size(); v++) {
+                    const RenderVariant& variant = variants[v];
+                    actual.resize(res.width, res.height);
+                    variant.enable(true);
+                    renderWarm(actual, variant.warmFrames, variant.warmTurn);
+                    variant.enable(false);
+                    checked++;
+                    
+                    CompareResult result = compareFrames(reference, actual, variant.compare);
+                    if (result.match) {
+                        std::printf("ok   %s [%s] (%d cells forgiven, %d differ)\n", name, variant.name,
+                                    result.forgiven, result.mismatches);
+                    } else {
+                        std::printf("FAIL %s [%s]: %d cells differ from the reference renderer\n%s", name,
+                                    variant.name, result.mismatches,
+                                    describeFrameDiff(reference, actual, 8).c_str());
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    
+    // The cheap levels see only 8 cells; in open space nearly every ray runs
+    // out, and those columns must stay blank rather than shade as far walls
+    for (int level = OPEN_SPACE_FIRST_LEVEL; level < QUALITY_LEVEL_COUNT; level++) {
+        const Resolution& res = RESOLUTIONS[0];
+        loadOpenMap(64);
+        Pose pose = { 32.5f, 32.5f, 0.3f };
+        setPose(pose);
+        applyQualityLevel(level);
+        reference.resize(res.width, res.height);
+        renderScene(reference);
+        applyQualityLevel(0);
+        
+        char name[96];
+        std::snprintf(name, sizeof(name), "open64-q%d-%s", level, resName(res).c_str());
+        if (!checkGolden(options, name, reference, checked)) failures++;
+    }
+    
+    temporalReuse = reuse;
+    
+    // Steady-state frames must not allocate at any size or quality level
+    if (!options.update && !options.replayPath.empty()) {
+        Replay replay;
+        std::string error;
+        if (!loadReplay(options.replayPath, replay, error)) {
+            std::printf("FAIL replay: %s\n", error.c_str());
+            checked++;
+            failures++;
+        } else {
+            // Render caches hold one frame size and keep their room when it
+            // shrinks, so the level walks go first, the largest size first
+            for (int r = RESOLUTION_COUNT - 1; r >= 0; r--) {
+                if (!checkReplayAllocations(replay, RESOLUTIONS[r], REPLAY_ALL_LEVELS, checked)) failures++;
+                for (int level = 0; level < QUALITY_LEVEL_COUNT; level++) {
+                    if (!checkReplayAllocations(replay, RESOLUTIONS[r], level, checked)) failures++;
+                }
+            }
+        }
+    }
+    
+    // Snapshots must arrive as the server chose them, under any loss
+    if (!options.update) {
+        failures += checkSnapshotCodec(checked);
+        static const int BUDGETS[] = { 60, SNAPSHOT_BUDGET_BYTES };
+        for (size_t b = 0; b < sizeof(BUDGETS) / sizeof(BUDGETS[0]); b++) {
+            if (!checkInterestViews(BUDGETS[b], checked)) failures++;
+        }
+    }
+    
+    if (!options.update) {
+        std::printf("%d of %d checks passed\n", checked - failures, checked);
+    }
+    return failures;
+}
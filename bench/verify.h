@@ -0,0 +1,24 @@
+#ifndef BENCH_VERIFY_H
+#define BENCH_VERIFY_H
+
+#include "golden.h"
+
+#include <string>
+
+struct VerifyOptions {
+    std::string goldenDir;  // Where the golden frames live
+    std::string replayPath; // Replay played back under allocation checks
+    bool update;            // Rewrite the golden frames instead of checking them
+    CompareOptions compare; // How the reference renderer is compared to the golden frames
+    
+    VerifyOptions() : update(false) {}
+};
+
+// Function to render the fixed scenes and check them against the golden
+// frames, then check every optimised render path against the reference
+// renderer, that playing a replay back allocates nothing once warm, and
+// that snapshots reach clients as the server chose them. Returns the number
+// of failures.
+int runVerify(const VerifyOptions& options);
+
+#endif // BENCH_VERIFY_H
@@ -1,1089 +1,734 @@
-#include <iostream>
-#include <vector>
-#include <cmath>
-#include <chrono>
-#include <thread>
-#include <algorithm>
-#include <string>
-#include <sstream>
-
-// Platform detection
-#if defined(_WIN32) || defined(_WIN64)
-    #define PLATFORM_WINDOWS
-    #include <windows.h>
-#else
-    #define PLATFORM_UNIX
-    #include <termios.h>
-    #include <unistd.h>
-    #include <fcntl.h>
-    #include <sys/ioctl.h>
-#endif
-
-// Screen dimensions
-const int SCREEN_WIDTH = 120;
-const int SCREEN_HEIGHT = 40;
-
-// Player properties
-float playerX = 8.0f;
-float playerY = 8.0f;
-float playerA = 0.0f; // Player angle
-float playerFOV = 3.14159f / 4.0f; // Field of view
-float playerSpeed = 5.0f; // Movement speed
-float playerRotSpeed = 3.14159f; // Rotation speed
-
-// Map dimensions
-const int MAP_WIDTH = 16;
-const int MAP_HEIGHT = 16;
-
-// Game map (1 = wall, 0 = empty space)
-std::string map;
-
-// Define trail length as a global constant
-const int BULLET_TRAIL_LENGTH = 5;
-
-// Constant for bullet active message
-const std::string BULLET_ACTIVE_MSG = "!!!!! BULLET ACTIVE !!!!!";
-
-// Bullets
-struct Bullet {
-    float x, y;
-    float dx, dy;
-    bool active;
-    
-    // Add trail positions to make bullets more visible
-    float trailX[BULLET_TRAIL_LENGTH];
-    float trailY[BULLET_TRAIL_LENGTH];
-    
-    Bullet() : x(0), y(0), dx(0), dy(0), active(false) {
-        // Initialize trail positions
-        for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
-            trailX[i] = 0;
-            trailY[i] = 0;
-        }
-    }
-};
-
-std::vector<Bullet> bullets;
-const int MAX_BULLETS = 10;
-float bulletSpeed = 5.0f; // Reduced to make bullets more visible
-
-// Enemies
-struct Enemy {
-    float x, y;
-    bool alive;
-    
-    Enemy(float _x, float _y) : x(_x), y(_y), alive(true) {}
-};
-
-std::vector<Enemy> enemies;
-
-// Debug counters
-int bulletsFired = 0;
-int activeBullets = 0;
-
-// Platform-specific keyboard input handling
-#ifdef PLATFORM_UNIX
-// Terminal mode settings
-struct termios orig_termios;
-
-// Function to initialize terminal for raw input
-void initTerminal() {
-    // Save original terminal settings
-    tcgetattr(STDIN_FILENO, &orig_termios);
-    
-    // Configure terminal for raw input
-    struct termios raw = orig_termios;
-    raw.c_lflag &= ~(ECHO | ICANON | ISIG); // Disable echo, canonical mode, and signals
-    raw.c_iflag &= ~(IXON | ICRNL);         // Disable software flow control and CR to NL
-    raw.c_oflag &= ~(OPOST);                // Disable output processing
-    raw.c_cc[VMIN] = 0;                     // Return immediately with whatever is available
-    raw.c_cc[VTIME] = 0;                    // No timeout
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
-    
-    // Set stdin to non-blocking
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-    
-    // Hide cursor and clear screen
-    std::cout << "\033[?25l";
-    std::cout << "\033[2J\033[H";
-    
-    // Print debug message
-    std::cout << "\033[1;32mTerminal initialized for WSL2. Press SPACE to shoot.\033[0m" << std::endl;
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-    std::cout << "\033[2J\033[H";
-}
-
-// Function to restore terminal settings
-void restoreTerminal() {
-    // Show cursor
-    std::cout << "\033[?25h";
-    
-    // Reset terminal
-    std::cout << "\033[0m";
-    std::cout << "\033[2J\033[H";
-    
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
-}
-
-// Function to check if a key is pressed
-bool isKeyPressed(char key) {
-    char c;
-    if (read(STDIN_FILENO, &c, 1) > 0) {
-        return c == key;
-    }
-    return false;
-}
-
-// Function to clear screen
-void clearScreen() {
-    // Clear screen and move cursor to home position
-    std::cout << "\033[2J\033[H";
-}
-
-// Function to get terminal size
-void getTerminalSize(int& width, int& height) {
-    struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-    width = w.ws_col;
-    height = w.ws_row;
-}
-#endif
-
-// Function to initialize the game
-void initGame() {
-    // Initialize map
-    map += "################";
-    map += "#..............#";
-    map += "#........#.....#";
-    map += "#........#.....#";
-    map += "#..............#";
-    map += "#.......####...#";
-    map += "#..............#";
-    map += "#..............#";
-    map += "#..............#";
-    map += "#..............#";
-    map += "#......##......#";
-    map += "#......##......#";
-    map += "#..............#";
-    map += "#..............#";
-    map += "#..............#";
-    map += "################";
-    
-    // Initialize bullets
-    bullets.resize(MAX_BULLETS);
-    
-    // Initialize enemies
-    enemies.push_back(Enemy(10.0f, 10.0f));
-    enemies.push_back(Enemy(5.0f, 5.0f));
-    enemies.push_back(Enemy(12.0f, 3.0f));
-    
-    #ifdef PLATFORM_UNIX
-    initTerminal();
-    #endif
-}
-
-// Function to shoot a bullet
-void shootBullet() {
-    // First check if we have reached the maximum number of bullets
-    if (activeBullets >= MAX_BULLETS) {
-        // Debug message for WSL2
-        #ifdef PLATFORM_UNIX
-        std::cout << "\033[1;31mMax bullets reached!\033[0m" << std::endl;
-        #endif
-        return;
-    }
-    
-    for (auto& bullet : bullets) {
-        if (!bullet.active) {
-            bullet.x = playerX;
-            bullet.y = playerY;
-            bullet.dx = sin(playerA) * bulletSpeed;
-            bullet.dy = cos(playerA) * bulletSpeed;
-            bullet.active = true;
-            
-            // Initialize all trail positions to create a visible initial trail
-            for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
-                // Offset slightly to create an immediate visible trail
-                bullet.trailX[i] = bullet.x - (sin(playerA) * 0.1f * i);
-                bullet.trailY[i] = bullet.y - (cos(playerA) * 0.1f * i);
-            }
-            
-            // Debug message and screen flash for WSL2
-            #ifdef PLATFORM_UNIX
-            // Flash the screen to make the bullet event very noticeable
-            std::cout << "\033[1;41m"; // Bright red background
-            for (int i = 0; i < 5; i++) { // Create 5 blank lines with red background
-                std::cout << "                          " << BULLET_ACTIVE_MSG << "                          " << std::endl;
-            }
-            std::cout << "\033[0m"; // Reset colors
-            
-            std::cout << "\033[1;31mBullet fired at position (" << bullet.x << ", " << bullet.y 
-                      << ") with direction (" << bullet.dx << ", " << bullet.dy << ")\033[0m" << std::endl;
-            #endif
-            
-            bulletsFired++;
-            activeBullets++;
-            
-            break;
-        }
-    }
-}
-
-// Function to update bullets
-void updateBullets(float elapsedTime) {
-    // Debug output for WSL2
-    #ifdef PLATFORM_UNIX
-    if (activeBullets > 0) {
-        std::cout << "\033[1;31mUpdating " << activeBullets << " active bullets\033[0m" << std::endl;
-    }
-    #endif
-    
-    for (auto& bullet : bullets) {
-        if (bullet.active) {
-            // Debug output for WSL2
-            #ifdef PLATFORM_UNIX
-            std::cout << "\033[1;33mBullet position: (" << bullet.x << ", " << bullet.y << ")\033[0m" << std::endl;
-            #endif
-            
-            // Update trail positions first (shift all positions)
-            for (int i = BULLET_TRAIL_LENGTH - 1; i > 0; i--) {
-                bullet.trailX[i] = bullet.trailX[i-1];
-                bullet.trailY[i] = bullet.trailY[i-1];
-            }
-            
-            // Store current position as first trail position
-            bullet.trailX[0] = bullet.x;
-            bullet.trailY[0] = bullet.y;
-            
-            // Update position
-            bullet.x += bullet.dx * elapsedTime;
-            bullet.y += bullet.dy * elapsedTime;
-            
-            // Check for collision with walls
-            int mapX = static_cast<int>(bullet.x);
-            int mapY = static_cast<int>(bullet.y);
-            
-            // Make sure we're in bounds
-            if (mapX < 0 || mapX >= MAP_WIDTH || mapY < 0 || mapY >= MAP_HEIGHT) {
-                bullet.active = false;
-                activeBullets--;
-                continue;
-            }
-            
-            // Check for wall collision
-            if (map[mapY * MAP_WIDTH + mapX] == '#') {
-                bullet.active = false;
-                activeBullets--;
-                continue;
-            }
-            
-            // Check for collision with enemies
-            for (auto& enemy : enemies) {
-                if (enemy.alive) {
-                    float distance = sqrt((bullet.x - enemy.x) * (bullet.x - enemy.x) + 
-                                         (bullet.y - enemy.y) * (bullet.y - enemy.y));
-                    if (distance < 0.5f) {
-                        enemy.alive = false;
-                        bullet.active = false;
-                        activeBullets--;
-                        break;
-                    }
-                }
-            }
-        }
-    }
-}
-
-// Function to check if a position is valid and not a wall
-bool isValidPosition(float x, float y) {
-    int mapX = (int)x;
-    int mapY = (int)y;
-    
-    // Check if position is within map bounds
-    if (mapX < 0 || mapX >= MAP_WIDTH || mapY < 0 || mapY >= MAP_HEIGHT) {
-        return false; // Outside map bounds
-    }
-    
-    // Check if position contains a wall
-    if (map[mapY * MAP_WIDTH + mapX] == '#') {
-        return false; // Wall collision
-    }
-    
-    return true; // Valid position
-}
-
-#ifdef PLATFORM_WINDOWS
-// Windows-specific rendering function
-void render(wchar_t* screen) {
-    // Clear screen
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
-        screen[i] = ' ';
-    }
-    
-    // Ray casting for 3D walls
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
-        // Calculate ray position and direction
-        float rayAngle = (playerA - playerFOV / 2.0f) + ((float)x / (float)SCREEN_WIDTH) * playerFOV;
-        
-        float rayDirX = sin(rayAngle);
-        float rayDirY = cos(rayAngle);
-        
-        // Distance to wall
-        float distanceToWall = 0.0f;
-        bool hitWall = false;
-        
-        // Step size
-        float stepSize = 0.1f;
-        
-        // Ray position
-        float rayX = playerX;
-        float rayY = playerY;
-        
-        while (!hitWall && distanceToWall < 16.0f) {
-            distanceToWall += stepSize;
-            rayX = playerX + rayDirX * distanceToWall;
-            rayY = playerY + rayDirY * distanceToWall;
-            
-            // Check if ray is out of bounds
-            if (rayX < 0 || rayX >= MAP_WIDTH || rayY < 0 || rayY >= MAP_HEIGHT) {
-                hitWall = true;
-                distanceToWall = 16.0f;
-            }
-            else {
-                // Check if ray hit a wall
-                if (map[(int)rayY * MAP_WIDTH + (int)rayX] == '#') {
-                    hitWall = true;
-                }
-            }
-        }
-        
-        // Calculate wall height
-        int ceiling = (float)(SCREEN_HEIGHT / 2.0) - SCREEN_HEIGHT / ((float)distanceToWall);
-        int floor = SCREEN_HEIGHT - ceiling;
-        
-        // Shade walls based on distance
-        wchar_t wallShade;
-        if (distanceToWall <= 1.0f) wallShade = 0x2588; // Very close
-        else if (distanceToWall < 2.0f) wallShade = 0x2593;
-        else if (distanceToWall < 4.0f) wallShade = 0x2592;
-        else if (distanceToWall < 8.0f) wallShade = 0x2591;
-        else wallShade = ' '; // Too far away
-        
-        // Draw walls
-        for (int y = 0; y < SCREEN_HEIGHT; y++) {
-            if (y < ceiling)
-                screen[y * SCREEN_WIDTH + x] = ' ';
-            else if (y >= ceiling && y <= floor)
-                screen[y * SCREEN_WIDTH + x] = wallShade;
-            else {
-                // Shade floor based on distance
-                float b = 1.0f - (((float)y - SCREEN_HEIGHT / 2.0f) / ((float)SCREEN_HEIGHT / 2.0f));
-                if (b < 0.25) screen[y * SCREEN_WIDTH + x] = '#';
-                else if (b < 0.5) screen[y * SCREEN_WIDTH + x] = 'x';
-                else if (b < 0.75) screen[y * SCREEN_WIDTH + x] = '.';
-                else if (b < 0.9) screen[y * SCREEN_WIDTH + x] = '-';
-                else screen[y * SCREEN_WIDTH + x] = ' ';
-            }
-        }
-    }
-    
-    // Draw enemies
-    for (const auto& enemy : enemies) {
-        if (enemy.alive) {
-            // Calculate angle to enemy
-            float enemyAngle = atan2(enemy.y - playerY, enemy.x - playerX);
-            
-            // Adjust angle to player's perspective
-            while (enemyAngle - playerA > 3.14159f) enemyAngle -= 2.0f * 3.14159f;
-            while (enemyAngle - playerA < -3.14159f) enemyAngle += 2.0f * 3.14159f;
-            
-            // Check if enemy is in field of view
-            bool inFOV = fabs(enemyAngle - playerA) < playerFOV / 2.0f;
-            
-            if (inFOV) {
-                // Calculate distance to enemy
-                float distance = sqrt((enemy.x - playerX) * (enemy.x - playerX) + 
-                                     (enemy.y - playerY) * (enemy.y - playerY));
-                
-                // Calculate enemy height and position on screen
-                int enemyHeight = (int)(SCREEN_HEIGHT / distance);
-                int enemyCenter = (int)((enemyAngle - playerA + playerFOV / 2.0f) / playerFOV * SCREEN_WIDTH);
-                
-                // Draw enemy
-                for (int y = 0; y < enemyHeight && y < SCREEN_HEIGHT; y++) {
-                    for (int x = 0; x < enemyHeight / 2 && x < SCREEN_WIDTH; x++) {
-                        int drawY = SCREEN_HEIGHT / 2 - enemyHeight / 2 + y;
-                        int drawX = enemyCenter - enemyHeight / 4 + x;
-                        
-                        if (drawX >= 0 && drawX < SCREEN_WIDTH && drawY >= 0 && drawY < SCREEN_HEIGHT) {
-                            screen[drawY * SCREEN_WIDTH + drawX] = 'E';
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    // Draw mini-map with border - make it smaller and position it in the corner
-    int miniMapWidth = std::min<int>(MAP_WIDTH, 16);  // Limit minimap width
-    int miniMapHeight = std::min<int>(MAP_HEIGHT, 16); // Limit minimap height
-    int mapStartX = SCREEN_WIDTH - miniMapWidth - 3;
-    
-    // Draw map content and border
-    for (int y = 0; y <= miniMapHeight + 1; y++) {
-        for (int x = 0; x <= miniMapWidth + 1; x++) {
-            int screenX = mapStartX + x - 1;
-            int screenIndex = y * SCREEN_WIDTH + screenX;
-            
-            // Check if we're within screen bounds
-            if (screenIndex >= 0 && screenIndex < SCREEN_WIDTH * SCREEN_HEIGHT) {
-                if (y == 0 || y == miniMapHeight + 1 || x == 0 || x == miniMapWidth + 1) {
-                    // Draw border
-                    screen[screenIndex] = '+';
-                } else if (y > 0 && y <= miniMapHeight && x > 0 && x <= miniMapWidth) {
-                    // Draw map content - scale if needed
-                    int mapY = (y - 1) * MAP_HEIGHT / miniMapHeight;
-                    int mapX = (x - 1) * MAP_WIDTH / miniMapWidth;
-                    screen[screenIndex] = map[mapY * MAP_WIDTH + mapX];
-                }
-            }
-        }
-    }
-    
-    // Draw player on mini-map - adjust for scaling
-    int playerMapY = (playerY * miniMapHeight / MAP_HEIGHT) + 1;
-    int playerMapX = (playerX * miniMapWidth / MAP_WIDTH);
-    int playerScreenX = mapStartX + playerMapX;
-    int playerScreenIndex = playerMapY * SCREEN_WIDTH + playerScreenX;
-    
-    if (playerScreenIndex >= 0 && playerScreenIndex < SCREEN_WIDTH * SCREEN_HEIGHT) {
-        screen[playerScreenIndex] = 'P';
-    }
-    
-    // Add a label for the mini-map
-    std::string mapLabel = "MAP";
-    for (size_t i = 0; i < mapLabel.size() && (mapStartX + i) < SCREEN_WIDTH; i++) {
-        screen[0 * SCREEN_WIDTH + (mapStartX + i)] = mapLabel[i];
-    }
-    
-    // Draw bullets last to ensure they appear on top of everything else
-    for (const auto& bullet : bullets) {
-        if (bullet.active) {
-            // Calculate angle to bullet
-            float bulletAngle = atan2(bullet.y - playerY, bullet.x - playerX);
-            
-            // Adjust angle to player's perspective
-            while (bulletAngle - playerA > 3.14159f) bulletAngle -= 2.0f * 3.14159f;
-            while (bulletAngle - playerA < -3.14159f) bulletAngle += 2.0f * 3.14159f;
-            
-            // Check if bullet is in field of view
-            bool inFOV = fabs(bulletAngle - playerA) < playerFOV / 2.0f;
-            
-            if (inFOV) {
-                // Calculate distance to bullet
-                float distance = sqrt((bullet.x - playerX) * (bullet.x - playerX) + 
-                                     (bullet.y - playerY) * (bullet.y - playerY));
-                
-                // Calculate bullet position on screen
-                int bulletCenter = (int)((bulletAngle - playerA + playerFOV / 2.0f) / playerFOV * SCREEN_WIDTH);
-                
-                // Draw the main bullet with MUCH larger, high-contrast characters
-                // Use a large block of characters to create a very visible bullet
-                for (int y = SCREEN_HEIGHT / 2 - 5; y <= SCREEN_HEIGHT / 2 + 5; y++) {
-                    for (int x = bulletCenter - 5; x <= bulletCenter + 5; x++) {
-                        if (y >= 0 && y < SCREEN_HEIGHT && x >= 0 && x < SCREEN_WIDTH) {
-                            // Distance from center to determine what character to use
-                            int distFromCenter = abs(y - SCREEN_HEIGHT / 2) + abs(x - bulletCenter);
-                            
-                            // Create a pattern for the bullet that makes it VERY visible
-                            if (distFromCenter <= 3) {
-                                // Use solid block for center
-                                screen[y * SCREEN_WIDTH + x] = '#';
-                            } else if (distFromCenter <= 5) {
-                                // Use X for outer part
-                                screen[y * SCREEN_WIDTH + x] = 'X';
-                            } else if (distFromCenter <= 8) {
-                                // Use asterisk for outer edge
-                                screen[y * SCREEN_WIDTH + x] = '*';
-                            }
-                        }
-                    }
-                }
-                
-                // Draw the bullet trail
-                for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
-                    // Skip the first position as it's already drawn as the main bullet
-                    if (i == 0) continue;
-                    
-                    // Calculate trail position on screen
-                    float trailAngle = atan2(bullet.trailY[i] - playerY, bullet.trailX[i] - playerX);
-                    
-                    // Adjust angle to player's perspective
-                    while (trailAngle - playerA > 3.14159f) trailAngle -= 2.0f * 3.14159f;
-                    while (trailAngle - playerA < -3.14159f) trailAngle += 2.0f * 3.14159f;
-                    
-                    // Check if trail is in field of view
-                    bool trailInFOV = fabs(trailAngle - playerA) < playerFOV / 2.0f;
-                    
-                    if (trailInFOV) {
-                        // Calculate trail position on screen
-                        int trailCenter = (int)((trailAngle - playerA + playerFOV / 2.0f) / playerFOV * SCREEN_WIDTH);
-                        
-                        // Draw trail segment (smaller than the main bullet)
-                        for (int y = SCREEN_HEIGHT / 2 - 1; y <= SCREEN_HEIGHT / 2 + 1; y++) {
-                            for (int x = trailCenter - 1; x <= trailCenter + 1; x++) {
-                                if (y >= 0 && y < SCREEN_HEIGHT && x >= 0 && x < SCREEN_WIDTH) {
-                                    // Use a different character for the trail
-                                    screen[y * SCREEN_WIDTH + x] = '*';
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    // Draw HUD
-    // Draw crosshair
-    screen[(SCREEN_HEIGHT / 2) * SCREEN_WIDTH + (SCREEN_WIDTH / 2)] = '+';
-    
-    // Draw stats
-    std::stringstream ss;
-    int aliveEnemies = 0;
-    for (const auto& enemy : enemies) {
-        if (enemy.alive) {
-            aliveEnemies++;
-        }
-    }
-    ss << "FPS: X | Enemies: " << aliveEnemies << " | Bullets Fired: " << bulletsFired << " | Active Bullets: " << activeBullets;
-    std::string stats = ss.str();
-    
-    for (size_t i = 0; i < stats.size() && i < SCREEN_WIDTH; i++) {
-        screen[i] = stats[i];
-    }
-}
-#else
-// Unix-specific rendering function
-void render() {
-    // Get terminal size
-    int termWidth, termHeight;
-    getTerminalSize(termWidth, termHeight);
-    
-    // Adjust screen dimensions if terminal is too small
-    int renderWidth = std::min<int>(SCREEN_WIDTH, termWidth);
-    int renderHeight = std::min<int>(SCREEN_HEIGHT, termHeight);
-    
-    // Create a buffer for the screen
-    std::vector<std::string> screenLines(renderHeight);
-    for (int y = 0; y < renderHeight; y++) {
-        screenLines[y].resize(renderWidth, ' ');
-    }
-    
-    // Ray casting for 3D walls
-    for (int x = 0; x < renderWidth; x++) {
-        // Calculate ray position and direction
-        float rayAngle = (playerA - playerFOV / 2.0f) + ((float)x / (float)renderWidth) * playerFOV;
-        
-        float rayDirX = sin(rayAngle);
-        float rayDirY = cos(rayAngle);
-        
-        // Distance to wall
-        float distanceToWall = 0.0f;
-        bool hitWall = false;
-        
-        // Step size
-        float stepSize = 0.1f;
-        
-        // Ray position
-        float rayX = playerX;
-        float rayY = playerY;
-        
-        while (!hitWall && distanceToWall < 16.0f) {
-            distanceToWall += stepSize;
-            rayX = playerX + rayDirX * distanceToWall;
-            rayY = playerY + rayDirY * distanceToWall;
-            
-            // Check if ray is out of bounds
-            if (rayX < 0 || rayX >= MAP_WIDTH || rayY < 0 || rayY >= MAP_HEIGHT) {
-                hitWall = true;
-                distanceToWall = 16.0f;
-            }
-            else {
-                // Check if ray hit a wall
-                if (map[(int)rayY * MAP_WIDTH + (int)rayX] == '#') {
-                    hitWall = true;
-                }
-            }
-        }
-        
-        // Calculate wall height
-        int ceiling = (float)(renderHeight / 2.0) - renderHeight / ((float)distanceToWall);
-        int floor = renderHeight - ceiling;
-        
-        // Shade walls based on distance
-        char wallShade;
-        if (distanceToWall <= 1.0f) wallShade = '#'; // Very close
-        else if (distanceToWall < 2.0f) wallShade = 'H';
-        else if (distanceToWall < 4.0f) wallShade = '=';
-        else if (distanceToWall < 8.0f) wallShade = '-';
-        else wallShade = ' '; // Too far away
-        
-        // Draw walls
-        for (int y = 0; y < renderHeight; y++) {
-            if (y < ceiling)
-                screenLines[y][x] = ' ';
-            else if (y >= ceiling && y <= floor)
-                screenLines[y][x] = wallShade;
-            else {
-                // Shade floor based on distance
-                float b = 1.0f - (((float)y - renderHeight / 2.0f) / ((float)renderHeight / 2.0f));
-                if (b < 0.25) screenLines[y][x] = '#';
-                else if (b < 0.5) screenLines[y][x] = 'x';
-                else if (b < 0.75) screenLines[y][x] = '.';
-                else if (b < 0.9) screenLines[y][x] = '-';
-                else screenLines[y][x] = ' ';
-            }
-        }
-    }
-    
-    // Draw enemies
-    for (const auto& enemy : enemies) {
-        if (enemy.alive) {
-            // Calculate angle to enemy
-            float enemyAngle = atan2(enemy.y - playerY, enemy.x - playerX);
-            
-            // Adjust angle to player's perspective
-            while (enemyAngle - playerA > 3.14159f) enemyAngle -= 2.0f * 3.14159f;
-            while (enemyAngle - playerA < -3.14159f) enemyAngle += 2.0f * 3.14159f;
-            
-            // Check if enemy is in field of view
-            bool inFOV = fabs(enemyAngle - playerA) < playerFOV / 2.0f;
-            
-            if (inFOV) {
-                // Calculate distance to enemy
-                float distance = sqrt((enemy.x - playerX) * (enemy.x - playerX) + 
-                                     (enemy.y - playerY) * (enemy.y - playerY));
-                
-                // Calculate enemy height and position on screen
-                int enemyHeight = (int)(renderHeight / distance);
-                int enemyCenter = (int)((enemyAngle - playerA + playerFOV / 2.0f) / playerFOV * renderWidth);
-                
-                // Draw enemy
-                for (int y = 0; y < enemyHeight && y < renderHeight; y++) {
-                    for (int x = 0; x < enemyHeight / 2 && x < renderWidth; x++) {
-                        int drawY = renderHeight / 2 - enemyHeight / 2 + y;
-                        int drawX = enemyCenter - enemyHeight / 4 + x;
-                        
-                        if (drawX >= 0 && drawX < renderWidth && drawY >= 0 && drawY < renderHeight) {
-                            screenLines[drawY][drawX] = 'E';
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    // Draw mini-map with border - make it smaller and position it in the corner
-    int miniMapWidth = std::min<int>(MAP_WIDTH, 16);  // Limit minimap width
-    int miniMapHeight = std::min<int>(MAP_HEIGHT, 16); // Limit minimap height
-    int mapStartX = renderWidth - miniMapWidth - 3;
-    
-    // Only draw mini-map if there's enough space
-    if (mapStartX > renderWidth / 2 && miniMapHeight + 2 < renderHeight) {
-        // Draw a border around the mini-map
-        for (int y = 0; y <= miniMapHeight + 1; y++) {
-            for (int x = 0; x <= miniMapWidth + 1; x++) {
-                // Calculate position in screen buffer
-                int screenX = mapStartX + x - 1;
-                
-                // Check if we're within screen bounds
-                if (screenX >= 0 && screenX < renderWidth && y < renderHeight) {
-                    if (y == 0 || y == miniMapHeight + 1 || x == 0 || x == miniMapWidth + 1) {
-                        // Draw border
-                        screenLines[y][screenX] = '+';
-                    } else if (y > 0 && y <= miniMapHeight && x > 0 && x <= miniMapWidth) {
-                        // Draw map content - scale if needed
-                        int mapY = (y - 1) * MAP_HEIGHT / miniMapHeight;
-                        int mapX = (x - 1) * MAP_WIDTH / miniMapWidth;
-                        screenLines[y][screenX] = map[mapY * MAP_WIDTH + mapX];
-                    }
-                }
-            }
-        }
-        
-        // Draw player on mini-map - adjust for scaling
-        int playerMapY = (playerY * miniMapHeight / MAP_HEIGHT) + 1;
-        int playerMapX = mapStartX + (playerX * miniMapWidth / MAP_WIDTH);
-        
-        if (playerMapY >= 0 && playerMapY < renderHeight && 
-            playerMapX >= 0 && playerMapX < renderWidth) {
-            screenLines[playerMapY][playerMapX] = 'P';
-        }
-        
-        // Add a label for the mini-map
-        std::string mapLabel = "MAP";
-        for (size_t i = 0; i < mapLabel.size() && (mapStartX + i) < renderWidth; i++) {
-            screenLines[0][mapStartX + i] = mapLabel[i];
-        }
-    }
-    
-    // Draw bullets last to ensure they appear on top of everything else
-    for (const auto& bullet : bullets) {
-        if (bullet.active) {
-            // Calculate angle to bullet
-            float bulletAngle = atan2(bullet.y - playerY, bullet.x - playerX);
-            
-            // Adjust angle to player's perspective
-            while (bulletAngle - playerA > 3.14159f) bulletAngle -= 2.0f * 3.14159f;
-            while (bulletAngle - playerA < -3.14159f) bulletAngle += 2.0f * 3.14159f;
-            
-            // Check if bullet is in field of view
-            bool inFOV = fabs(bulletAngle - playerA) < playerFOV / 2.0f;
-            
-            if (inFOV) {
-                // Calculate distance to bullet
-                float distance = sqrt((bullet.x - playerX) * (bullet.x - playerX) + 
-                                     (bullet.y - playerY) * (bullet.y - playerY));
-                
-                // Calculate bullet position on screen
-                int bulletCenter = (int)((bulletAngle - playerA + playerFOV / 2.0f) / playerFOV * renderWidth);
-                
-                // Draw the main bullet with MUCH larger, high-contrast characters
-                // Use a large block of characters to create a very visible bullet
-                for (int y = renderHeight / 2 - 5; y <= renderHeight / 2 + 5; y++) {
-                    for (int x = bulletCenter - 5; x <= bulletCenter + 5; x++) {
-                        if (y >= 0 && y < renderHeight && x >= 0 && x < renderWidth) {
-                            // Distance from center to determine what character to use
-                            int distFromCenter = abs(y - renderHeight / 2) + abs(x - bulletCenter);
-                            
-                            // Create a pattern for the bullet that makes it VERY visible
-                            if (distFromCenter <= 3) {
-                                // Use solid block for center
-                                screenLines[y][x] = '#';
-                            } else if (distFromCenter <= 5) {
-                                // Use X for outer part
-                                screenLines[y][x] = 'X';
-                            } else if (distFromCenter <= 8) {
-                                // Use asterisk for outer edge
-                                screenLines[y][x] = '*';
-                            }
-                        }
-                    }
-                }
-                
-                // Draw the bullet trail
-                for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
-                    // Skip the first position as it's already drawn as the main bullet
-                    if (i == 0) continue;
-                    
-                    // Calculate trail position on screen
-                    float trailAngle = atan2(bullet.trailY[i] - playerY, bullet.trailX[i] - playerX);
-                    
-                    // Adjust angle to player's perspective
-                    while (trailAngle - playerA > 3.14159f) trailAngle -= 2.0f * 3.14159f;
-                    while (trailAngle - playerA < -3.14159f) trailAngle += 2.0f * 3.14159f;
-                    
-                    // Check if trail is in field of view
-                    bool trailInFOV = fabs(trailAngle - playerA) < playerFOV / 2.0f;
-                    
-                    if (trailInFOV) {
-                        // Calculate trail position on screen
-                        int trailCenter = (int)((trailAngle - playerA + playerFOV / 2.0f) / playerFOV * renderWidth);
-                        
-                        // Draw trail segment (smaller than the main bullet)
-                        for (int y = renderHeight / 2 - 1; y <= renderHeight / 2 + 1; y++) {
-                            for (int x = trailCenter - 1; x <= trailCenter + 1; x++) {
-                                if (y >= 0 && y < renderHeight && x >= 0 && x < renderWidth) {
-                                    // Use a different character for the trail
-                                    screenLines[y][x] = '*';
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                // Add a prominent debug message at the top of the screen
-                for (size_t i = 0; i < BULLET_ACTIVE_MSG.size() && i + 20 < renderWidth; i++) {
-                    screenLines[2][i + 20] = BULLET_ACTIVE_MSG[i];
-                }
-            }
-        }
-    }
-    
-    // Draw HUD
-    // Draw crosshair
-    if (renderHeight / 2 < renderHeight && renderWidth / 2 < renderWidth) {
-        screenLines[renderHeight / 2][renderWidth / 2] = '+';
-    }
-    
-    // Draw stats
-    std::stringstream ss;
-    int aliveEnemies = 0;
-    for (const auto& enemy : enemies) {
-        if (enemy.alive) {
-            aliveEnemies++;
-        }
-    }
-    ss << "FPS: X | Enemies: " << aliveEnemies << " | Bullets Fired: " << bulletsFired << " | Active Bullets: " << activeBullets;
-    std::string stats = ss.str();
-    
-    for (size_t i = 0; i < stats.size() && i < renderWidth; i++) {
-        screenLines[0][i] = stats[i];
-    }
-    
-    // Draw screen
-    clearScreen();
-    for (int y = 0; y < renderHeight; y++) {
-        std::string line = "";
-        for (int x = 0; x < renderWidth; x++) {
-            char c = screenLines[y][x];
-            // Add color to bullets and trails with enhanced visibility
-            if (c == '#') {
-                line += "\033[1;31m#\033[0m"; // Bright red for bullet center
-            } else if (c == 'X') {
-                line += "\033[1;33mX\033[0m"; // Bright yellow for bullet middle
-            } else if (c == '*') {
-                line += "\033[1;32m*\033[0m"; // Bright green for trail/outer edge
-            } else if (y == 2 && x >= 20 && x < 20 + BULLET_ACTIVE_MSG.size()) {
-                // Special coloring for the bullet message area
-                if (screenLines[y][x] != ' ') {
-                    line += "\033[5;31m"; // Blinking red for bullet message
-                    line += c;
-                    line += "\033[0m";
-                } else {
-                    line += c;
-                }
-            } else {
-                line += c;
-            }
-        }
-        std::cout << line << std::endl;
-    }
-}
-#endif
-
-int main() {
-    // Initialize game
-    initGame();
-    
-#ifdef PLATFORM_WINDOWS
-    // Create screen buffer
-    wchar_t* screen = new wchar_t[SCREEN_WIDTH * SCREEN_HEIGHT];
-    HANDLE console = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, 0, NULL, CONSOLE_TEXTMODE_BUFFER, NULL);
-    
-    // Check if console creation was successful
-    if (console == INVALID_HANDLE_VALUE) {
-        std::cerr << "Error creating console buffer: " << GetLastError() << std::endl;
-        delete[] screen;
-        return 1;
-    }
-    
-    SetConsoleActiveScreenBuffer(console);
-    DWORD bytesWritten = 0;
-#endif
-    
-    // Game loop variables
-    auto tp1 = std::chrono::system_clock::now();
-    auto tp2 = std::chrono::system_clock::now();
-    
-    // Frame rate control
-    const int TARGET_FPS = 30;
-    const std::chrono::milliseconds FRAME_DURATION(1000 / TARGET_FPS);
-    
-    // Game loop
-    bool gameRunning = true;
-    while (gameRunning) {
-        // Start frame timing
-        auto frameStart = std::chrono::high_resolution_clock::now();
-        
-        // Calculate elapsed time
-        tp2 = std::chrono::system_clock::now();
-        std::chrono::duration<float> elapsedTime = tp2 - tp1;
-        tp1 = tp2;
-        float fElapsedTime = elapsedTime.count();
-        
-#ifdef PLATFORM_WINDOWS
-        // Handle input
-        if (GetAsyncKeyState('W') & 0x8000) {
-            float newX = playerX + sin(playerA) * playerSpeed * fElapsedTime;
-            float newY = playerY + cos(playerA) * playerSpeed * fElapsedTime;
-            
-            // Collision detection with bounds checking
-            if (isValidPosition(newX, newY)) {
-                playerX = newX;
-                playerY = newY;
-            }
-        }
-        
-        if (GetAsyncKeyState('S') & 0x8000) {
-            float newX = playerX - sin(playerA) * playerSpeed * fElapsedTime;
-            float newY = playerY - cos(playerA) * playerSpeed * fElapsedTime;
-            
-            // Collision detection with bounds checking
-            if (isValidPosition(newX, newY)) {
-                playerX = newX;
-                playerY = newY;
-            }
-        }
-        
-        if (GetAsyncKeyState('A') & 0x8000) {
-            float newX = playerX - cos(playerA) * playerSpeed * fElapsedTime;
-            float newY = playerY + sin(playerA) * playerSpeed * fElapsedTime;
-            
-            // Collision detection with bounds checking
-            if (isValidPosition(newX, newY)) {
-                playerX = newX;
-                playerY = newY;
-            }
-        }
-        
-        if (GetAsyncKeyState('D') & 0x8000) {
-            float newX = playerX + cos(playerA) * playerSpeed * fElapsedTime;
-            float newY = playerY - sin(playerA) * playerSpeed * fElapsedTime;
-            
-            // Collision detection with bounds checking
-            if (isValidPosition(newX, newY)) {
-                playerX = newX;
-                playerY = newY;
-            }
-        }
-        
-        if (GetAsyncKeyState(VK_LEFT) & 0x8000) {
-            playerA -= playerRotSpeed * fElapsedTime;
-        }
-        
-        if (GetAsyncKeyState(VK_RIGHT) & 0x8000) {
-            playerA += playerRotSpeed * fElapsedTime;
-        }
-        
-        if (GetAsyncKeyState(VK_SPACE) & 0x8000) {
-            static bool spacePressed = false;
-            if (!spacePressed) {
-                shootBullet();
-                spacePressed = true;
-            }
-            else {
-                spacePressed = false;
-            }
-        }
-        
-        if (GetAsyncKeyState(VK_ESCAPE) & 0x8000) {
-            gameRunning = false;
-        }
-#else
-        // Handle input for Unix systems
-        char c = 0;  // Initialize to avoid undefined behavior
-        
-        // Make input non-blocking for Unix/WSL2
-        int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-        if (flags != -1) {
-            fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-        }
-        
-        // Check for input
-        while (read(STDIN_FILENO, &c, 1) > 0) {
-            switch (c) {
-                case 'w':
-                    {
-                        float newX = playerX + sin(playerA) * playerSpeed * fElapsedTime;
-                        float newY = playerY + cos(playerA) * playerSpeed * fElapsedTime;
-                        
-                        // Collision detection with bounds checking
-                        if (isValidPosition(newX, newY)) {
-                            playerX = newX;
-                            playerY = newY;
-                        }
-                    }
-                    break;
-                case 's':
-                    {
-                        float newX = playerX - sin(playerA) * playerSpeed * fElapsedTime;
-                        float newY = playerY - cos(playerA) * playerSpeed * fElapsedTime;
-                        
-                        // Collision detection with bounds checking
-                        if (isValidPosition(newX, newY)) {
-                            playerX = newX;
-                            playerY = newY;
-                        }
-                    }
-                    break;
-                case 'a':
-                    {
-                        float newX = playerX - cos(playerA) * playerSpeed * fElapsedTime;
-                        float newY = playerY + sin(playerA) * playerSpeed * fElapsedTime;
-                        
-                        // Collision detection with bounds checking
-                        if (isValidPosition(newX, newY)) {
-                            playerX = newX;
-                            playerY = newY;
-                        }
-                    }
-                    break;
-                case 'd':
-                    {
-                        float newX = playerX + cos(playerA) * playerSpeed * fElapsedTime;
-                        float newY = playerY - sin(playerA) * playerSpeed * fElapsedTime;
-                        
-                        // Collision detection with bounds checking
-                        if (isValidPosition(newX, newY)) {
-                            playerX = newX;
-                            playerY = newY;
-                        }
-                    }
-                    break;
-                case 'q': // Left arrow substitute
-                    playerA -= playerRotSpeed * fElapsedTime;
-                    break;
-                case 'e': // Right arrow substitute
-                    playerA += playerRotSpeed * fElapsedTime;
-                    break;
-                case ' ':
-                    shootBullet();
-                    // Add a small delay to prevent multiple shots
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    break;
-                default:
-                    break;
-            }
-        }
-        
-        // Handle ESC key separately
-        if (c == 27) {
-            gameRunning = false;
-        }
-#endif  // Close the platform-specific input handling block
-        
-        // Update bullets
-        updateBullets(fElapsedTime);
-        
-        // Render
-#ifdef PLATFORM_WINDOWS
-        render(screen);
-        
-        // Display frame
-        screen[SCREEN_WIDTH * SCREEN_HEIGHT - 1] = '\0';
-        WriteConsoleOutputCharacter(console, screen, SCREEN_WIDTH * SCREEN_HEIGHT, { 0, 0 }, &bytesWritten);
-#else
-        render();
-#endif
-        
-        // Frame rate control
-        auto frameEnd = std::chrono::high_resolution_clock::now();
-        auto frameDuration = std::chrono::duration_cast<std::chrono::milliseconds>(frameEnd - frameStart);
-        if (frameDuration < FRAME_DURATION) {
-            std::this_thread::sleep_for(FRAME_DURATION - frameDuration);
-        }
-    }
-    
-    // Clean up
-#ifdef PLATFORM_WINDOWS
-    delete[] screen;
-    CloseHandle(console);
-#else
-    restoreTerminal();
-#endif
-    
-    return 0;
-} 
\ No newline at end of file
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "src/platform.h"
+#include "src/game.h"
+#include "src/terminal.h"
+#include "src/render.h"
+#include "src/present.h"
+#include "src/replay.h"
+#include "src/profile.h"
+#include "src/metrics.h"
+#include "src/trace.h"
+#include "src/perf_counters.h"
+#include "src/governor.h"
+#include "src/minimap.h"
+#include "src/net.h"
+#include "src/server.h"
+#include "src/client.h"
+#include "src/bots.h"
+#include "src/spectate.h"
+
+// Frame rate control
+const int TARGET_FPS = 30;
+
+// Frames allowed to allocate while buffers and caches warm up
+const int ALLOC_WARMUP_FRAMES = 60;
+
+// Command line options
+struct GameOptions {
+    bool headless;          // Render without a terminal
+    std::string replayPath; // Canned input to play back
+    int frames;             // Frames to run in headless mode (0 = length of the replay)
+    int width, height;      // Headless framebuffer size
+    std::string metricsPath; // JSON-lines metrics output
+    int metricsEvery;       // Frames per metrics record
+    std::string tracePath;  // Chrome trace-event output
+    bool assertNoAlloc;     // Fail when a steady-state frame allocates
+    bool perf;              // Read hardware performance counters around stages
+    int quality;            // Fixed quality level, -1 lets the governor pick
+    bool governor;          // Run the frame-budget governor in headless mode
+    double budgetMs;        // Frame time the governor aims for
+    int serverPort;         // Run a dedicated server on this UDP port, 0 = play
+    bool interest;          // Server: send each client only what is near and in sight
+    int snapshotBudget;     // Server: snapshot bytes per client per tick
+    std::string connectTo;  // Join the server at host:port
+    int spectatePort;       // Stream the frames to TCP viewers on this port, 0 = no one watches
+    BotLoadOptions bots;    // Load-test a server with bots when maxBots > 0
+    
+    GameOptions() : headless(false), frames(0), width(SCREEN_WIDTH), height(SCREEN_HEIGHT), metricsEvery(1), assertNoAlloc(false), perf(false),
+                    quality(-1), governor(false), budgetMs(1000.0 / TARGET_FPS), serverPort(0),
+                    interest(true), snapshotBudget(SNAPSHOT_BUDGET_BYTES), spectatePort(0) {}
+};
+
+// Function to print command line help
+void printUsage(const char* argv0) {
+    std::cout << "usage: " << argv0 << " [options]\n"
+              << "  --headless        run without a terminal, as fast as possible\n"
+              << "  --replay FILE     play back canned input (see replays/)\n"
+              << "  --frames N        number of frames to run in headless mode (ticks in server mode)\n"
+              << "  --size WxH        headless framebuffer size (default 120x40)\n"
+              << "  --metrics FILE    write per-frame metrics to FILE as JSON lines\n"
+              << "  --metrics-every N one metrics record per N frames (default 1)\n"
+              << "  --trace FILE      record a Chrome trace-event timeline, written on exit or with T\n"
+              << "  --assert-no-alloc exit with an error if a frame allocates after warm-up\n"
+              << "  --perf            read hardware performance counters around each stage (Linux)\n"
+              << "  --quality N       fix the quality level, 0 (full) to " << QUALITY_LEVEL_COUNT - 1 << " (cheapest)\n"
+              << "  --governor        scale quality to the frame budget in headless mode too\n"
+              << "  --budget MS       frame time the governor aims for (default " << 1000 / TARGET_FPS << " ms)\n"
+              << "  --server PORT     run a dedicated multiplayer server on a UDP port (Linux/Unix)\n"
+              << "  --snapshot-budget BYTES\n"
+              << "                    server: snapshot bytes per client per tick (default " << SNAPSHOT_BUDGET_BYTES << ")\n"
+              << "  --no-interest     server: send every client the whole world, every tick\n"
+              << "  --connect H:PORT  play on the server at host:port (Linux/Unix)\n"
+              << "  --spectate PORT   let viewers watch over telnet on a TCP port (Linux/Unix)\n"
+              << "  --bots N          load-test a server with up to N bots, no rendering (Linux/Unix);\n"
+              << "                    with --connect the bots join that server, else one in the process\n"
+              << "  --ramp N          bots added per stage (default an eighth of --bots)\n"
+              << "  --stage-seconds S length of a stage (default 5)\n"
+              << "  --random-walk     bots wander at random instead of following a script\n";
+}
+
+// Function to parse command line options, returns false on bad input
+bool parseOptions(int argc, char** argv, GameOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--replay" && hasValue) {
+            options.replayPath = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        } else if (arg == "--metrics" && hasValue) {
+            options.metricsPath = argv[++i];
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg == "--quality" && hasValue) {
+            options.quality = std::atoi(argv[++i]);
+            if (options.quality < 0 || options.quality >= QUALITY_LEVEL_COUNT) return false;
+        } else if (arg == "--governor") {
+            options.governor = true;
+        } else if (arg == "--budget" && hasValue) {
+            options.budgetMs = std::atof(argv[++i]);
+            if (options.budgetMs <= 0.0) return false;
+        } else if (arg == "--server" && hasValue) {
+            options.serverPort = std::atoi(argv[++i]);
+            if (options.serverPort <= 0 || options.serverPort > 65535) return false;
+        } else if (arg == "--snapshot-budget" && hasValue) {
+            options.snapshotBudget = std::atoi(argv[++i]);
+            if (options.snapshotBudget <= 0) return false;
+        } else if (arg == "--no-interest") {
+            options.interest = false;
+        } else if (arg == "--connect" && hasValue) {
+            options.connectTo = argv[++i];
+        } else if (arg == "--bots" && hasValue) {
+            options.bots.maxBots = std::atoi(argv[++i]);
+            if (options.bots.maxBots <= 0) return false;
+        } else if (arg == "--ramp" && hasValue) {
+            options.bots.ramp = std::atoi(argv[++i]);
+            if (options.bots.ramp <= 0) return false;
+        } else if (arg == "--stage-seconds" && hasValue) {
+            options.bots.stageSeconds = std::atof(argv[++i]);
+            if (options.bots.stageSeconds <= 0.0) return false;
+        } else if (arg == "--random-walk") {
+            options.bots.behaviour = BOTS_RANDOM_WALK;
+        } else if (arg == "--spectate" && hasValue) {
+            options.spectatePort = std::atoi(argv[++i]);
+            if (options.spectatePort <= 0 || options.spectatePort > 65535) return false;
+        } else if (arg == "--assert-no-alloc") {
+            options.assertNoAlloc = true;
+        } else if (arg == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (arg == "--metrics-every" && hasValue) {
+            options.metricsEvery = std::atoi(argv[++i]);
+        } else if (arg == "--size" && hasValue) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if (x == std::string::npos) return false;
+            options.width = std::atoi(size.substr(0, x).c_str());
+            options.height = std::atoi(size.substr(x + 1).c_str());
+            if (options.width <= 0 || options.height <= 0) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to open the metrics and trace outputs, returns false on error
+bool startInstrumentation(const GameOptions& options) {
+    if (!options.tracePath.empty()) {
+        if (!startTracing(options.tracePath)) {
+            std::cerr << "cannot open trace file " << options.tracePath << std::endl;
+            return false;
+        }
+        traceThreadName("main");
+    }
+    
+    if (!options.metricsPath.empty() && !openMetrics(options.metricsPath, options.metricsEvery)) {
+        std::cerr << "cannot open metrics file " << options.metricsPath << std::endl;
+        return false;
+    }
+    
+    // Counters are a nice-to-have, run without them if the system refuses
+    std::string perfError;
+    if (options.perf && !openPerfCounters(perfError)) {
+        std::cerr << "hardware counters unavailable, continuing without: " << perfError << std::endl;
+    }
+    return true;
+}
+
+// Function to set the starting quality level, returns true when the governor should run
+bool startQuality(const GameOptions& options, FrameGovernor& governor, bool governByDefault) {
+    initGovernor(governor, options.budgetMs);
+    if (options.quality >= 0) {
+        applyQualityLevel(options.quality);
+        return false;
+    }
+    applyQualityLevel(0);
+    return governByDefault || options.governor;
+}
+
+// Function to check whether a frame past warm-up allocated
+bool steadyStateAllocated(const GameOptions& options, const FrameStats& stats) {
+    return options.assertNoAlloc && stats.frame >= ALLOC_WARMUP_FRAMES && stats.allocations > 0;
+}
+
+// Function to explain which stages of a frame allocated
+void reportFrameAllocations(const FrameStats& stats) {
+    std::cerr << "frame " << stats.frame << " allocated " << stats.allocations
+              << " times (" << stats.allocBytes << " bytes) after warm-up:";
+    for (int i = 0; i <= STAGE_COUNT; i++) {
+        if (stats.stageAllocs[i] > 0) {
+            std::cerr << " " << (i < STAGE_COUNT ? stageName((Stage)i) : "other") << "=" << stats.stageAllocs[i];
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Function to flush and close the metrics and trace outputs
+void stopInstrumentation() {
+    closeMetrics();
+    stopTracing();
+    closePerfCounters();
+}
+
+// Function to start streaming frames to viewers when asked, returns false on error
+bool startSpectating(const GameOptions& options, SpectatorServer& spectators) {
+    if (options.spectatePort <= 0) return true;
+    std::string error;
+    if (!startSpectators(spectators, (unsigned short)options.spectatePort, error)) {
+        std::cerr << "cannot open spectator port " << options.spectatePort << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Function to print what the viewers were sent
+void printSpectatorSummary(const SpectatorServer& spectators) {
+    const SpectatorStats& stats = spectators.stats;
+    if (stats.joined == 0) return;
+    std::printf("spectators: %lu joined, %lu resyncs, %lu keyframes, %.1f KB sent, %.1f us per frame\n",
+                stats.joined, stats.resyncs, stats.keyframes, stats.bytesSent / 1024.0,
+                stats.frames ? stats.broadcastMs * 1000.0 / stats.frames : 0.0);
+}
+
+// Function to print per-stage time and hardware counter rates for a run
+void printStageSummary(const double* stageMs, const unsigned long long (*stagePerf)[PERF_COUNTER_COUNT], int frames) {
+    std::printf("%-10s %10s %14s %8s %14s %14s\n", "stage", "ms/frame", "cycles/frame", "IPC",
+                "cache miss/kI", "branch miss/kI");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const unsigned long long* perf = stagePerf[i];
+        if (stageMs[i] <= 0.0) continue;
+        double instructions = (double)perf[PERF_INSTRUCTIONS];
+        std::printf("%-10s %10.4f %14.0f %8.2f %14.2f %14.2f\n", stageName((Stage)i), stageMs[i] / frames,
+                    (double)perf[PERF_CYCLES] / frames,
+                    perf[PERF_CYCLES] ? instructions / perf[PERF_CYCLES] : 0.0,
+                    instructions > 0 ? perf[PERF_CACHE_MISSES] * 1000.0 / instructions : 0.0,
+                    instructions > 0 ? perf[PERF_BRANCH_MISSES] * 1000.0 / instructions : 0.0);
+    }
+}
+
+// Function to run the simulation and renderer without a terminal.
+// Every frame advances by a fixed time step, so a replay always produces the
+// same frames; this is what profile-guided builds are trained on.
+int runHeadless(const GameOptions& options) {
+    initWorld();
+    debugOutput = false;
+    
+    if (!startInstrumentation(options)) {
+        return 1;
+    }
+    
+    SpectatorServer spectators;
+    if (!startSpectating(options, spectators)) {
+        return 1;
+    }
+    
+    Replay replay;
+    if (!options.replayPath.empty()) {
+        std::string error;
+        if (!loadReplay(options.replayPath, replay, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+    
+    int frames = options.frames > 0 ? options.frames : (int)replay.frames.size();
+    if (frames <= 0) frames = TARGET_FPS * 10;
+    
+    // Replays stay deterministic unless the governor is asked for
+    FrameGovernor governor;
+    bool governed = startQuality(options, governor, false);
+    int qualityChanges = 0;
+    
+    const float fElapsedTime = 1.0f / TARGET_FPS;
+    FrameBuffer frame;
+    frame.resize(options.width, options.height);
+    std::string encoded;
+    size_t bytesEncoded = 0;
+    double stageMs[STAGE_COUNT] = { 0.0 };
+    unsigned long long stagePerf[STAGE_COUNT][PERF_COUNTER_COUNT] = { { 0 } };
+    
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        beginFrameStats(f);
+        
+        if (!replay.frames.empty()) {
+            StageTimer timer(STAGE_INPUT);
+            const std::string& keys = replay.frames[f % replay.frames.size()];
+            for (size_t k = 0; k < keys.size(); k++) {
+                applyKey(keys[k], fElapsedTime);
+            }
+        }
+        
+        {
+            StageTimer timer(STAGE_UPDATE);
+            updateBullets(fElapsedTime);
+        }
+        renderScene(frame);
+        {
+            StageTimer timer(STAGE_ENCODE);
+            encodeFrame(frame, encoded);
+        }
+        bytesEncoded += encoded.size();
+        currentFrame.bytesWritten = encoded.size(); // What a terminal would have received
+        if (spectators.listenFd >= 0) {
+            StageTimer timer(STAGE_WRITE);
+            broadcastFrame(spectators, frame);
+        }
+        // Nothing presents the frame here, so its changes count as sent
+        // once the viewers have them
+        frame.dirty.reset(frame.height);
+        
+        endFrameStats(options.budgetMs);
+        recordFrameMetrics(currentFrame);
+        if (governed && updateGovernor(governor, currentFrame.frameMs)) {
+            qualityChanges++;
+        }
+        
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            stageMs[i] += currentFrame.stageMs[i];
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+                stagePerf[i][c] += currentFrame.stagePerf[i][c];
+            }
+        }
+        
+        if (steadyStateAllocated(options, currentFrame)) {
+            reportFrameAllocations(currentFrame);
+            stopSpectators(spectators);
+            stopInstrumentation();
+            return 1;
+        }
+    }
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+    
+    std::cout << "frames: " << frames
+              << " | size: " << options.width << "x" << options.height
+              << " | total: " << total.count() * 1000.0 << " ms"
+              << " | per frame: " << total.count() * 1e6 / frames << " us"
+              << " | bytes encoded: " << bytesEncoded
+              << " | quality: " << qualityLevel;
+    if (governed) {
+        std::cout << " (" << qualityChanges << " changes)";
+    }
+    std::cout << std::endl;
+    if (perfCountersEnabled) {
+        printStageSummary(stageMs, stagePerf, frames);
+    }
+    stopSpectators(spectators);
+    printSpectatorSummary(spectators);
+    stopInstrumentation();
+    return 0;
+}
+
+// Function to run a dedicated server: no terminal and no rendering, one tick
+// every 1/NET_TICK_RATE s and a status line every few seconds
+int runServer(const GameOptions& options) {
+    if (!startInstrumentation(options)) {
+        return 1;
+    }
+    
+    GameServer server;
+    server.interest = options.interest;
+    server.snapshotBudget = options.snapshotBudget;
+    std::string error;
+    if (!startServer(server, (unsigned short)options.serverPort, error)) {
+        std::cerr << "cannot start server: " << error << std::endl;
+        stopInstrumentation();
+        return 1;
+    }
+    std::cout << "server listening on UDP port " << boundPort(server.socket) << std::endl;
+    
+    const int STATUS_TICKS = NET_TICK_RATE * 5;
+    const std::chrono::microseconds TICK(1000000 / NET_TICK_RATE);
+    auto nextTick = std::chrono::steady_clock::now();
+    ServerStats last = server.stats;
+    for (long t = 0; options.frames <= 0 || t < options.frames; t++) {
+        serverTick(server);
+        
+        if (server.tick % STATUS_TICKS == 0) {
+            const ServerStats& now = server.stats;
+            double seconds = (double)STATUS_TICKS / NET_TICK_RATE;
+            double perClient = server.clientCount > 0 ? (now.snapshotBytes - last.snapshotBytes) / seconds / server.clientCount : 0.0;
+            std::printf("tick %u | clients %d | tick %.3f ms | %.1f KB/s per client | full snapshots %lu",
+                        server.tick, server.clientCount, (now.tickMs - last.tickMs) / STATUS_TICKS, perClient / 1024.0,
+                        now.fullSnapshots - last.fullSnapshots);
+            
+            // Entities per client per tick
+            double views = (double)(now.snapshots - last.snapshots);
+            if (server.interest && views > 0) {
+                std::printf(" | entities %.1f sent %.1f held %.1f capped of %.1f", (now.interest.sent - last.interest.sent) / views,
+                            (now.interest.held - last.interest.held) / views, (now.interest.capped - last.interest.capped) / views,
+                            (now.interest.relevant - last.interest.relevant) / views);
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+            last = now;
+        }
+        
+        nextTick += TICK;
+        std::this_thread::sleep_until(nextTick);
+    }
+    
+    stopServer(server);
+    stopInstrumentation();
+    return 0;
+}
+
+// Function to load-test a server with bots, one report line per stage
+int runBots(GameOptions& options) {
+    BotLoadOptions& bots = options.bots;
+    bots.connectTo = options.connectTo;
+    if (bots.ramp <= 0) bots.ramp = std::max(1, bots.maxBots / 8);
+    
+    std::string error;
+    if (!runBotLoad(bots, stdout, error)) {
+        std::cerr << "bots: " << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Network game the keyboard feeds, NULL when playing alone
+static NetClient* netClient = NULL;
+
+// Function to explain why a network game has to end, NULL while it can go on
+const char* connectionProblem(const NetClient& client, long frame) {
+    if (client.state == CLIENT_REJECTED) return "the server is full";
+    if (client.state == CLIENT_DISCONNECTED) return "the server closed the connection";
+    if (client.state == CLIENT_CONNECTING && frame > TARGET_FPS * 5) return "no answer from the server";
+    return NULL;
+}
+
+// Function to read the keyboard, returns false when the player quits
+bool handleInput(float fElapsedTime) {
+#ifdef PLATFORM_WINDOWS
+    // Handle input
+    if (GetAsyncKeyState('W') & 0x8000) applyKey('w', fElapsedTime);
+    if (GetAsyncKeyState('S') & 0x8000) applyKey('s', fElapsedTime);
+    if (GetAsyncKeyState('A') & 0x8000) applyKey('a', fElapsedTime);
+    if (GetAsyncKeyState('D') & 0x8000) applyKey('d', fElapsedTime);
+    if (GetAsyncKeyState(VK_LEFT) & 0x8000) applyKey('q', fElapsedTime);
+    if (GetAsyncKeyState(VK_RIGHT) & 0x8000) applyKey('e', fElapsedTime);
+    
+    if (GetAsyncKeyState(VK_SPACE) & 0x8000) {
+        static bool spacePressed = false;
+        if (!spacePressed) {
+            applyKey(' ', fElapsedTime);
+            spacePressed = true;
+        }
+        else {
+            spacePressed = false;
+        }
+    }
+    
+    if (GetAsyncKeyState('M') & 0x8000) {
+        static bool mPressed = false;
+        if (!mPressed) {
+            cycleMiniMapZoom();
+            mPressed = true;
+        }
+        else {
+            mPressed = false;
+        }
+    }
+    
+    // Write the timeline recorded so far, once per press rather than every
+    // frame the key is held
+    static bool tWasDown = false;
+    bool tDown = (GetAsyncKeyState('T') & 0x8000) != 0;
+    if (tDown && !tWasDown) {
+        dumpTrace();
+    }
+    tWasDown = tDown;
+    
+    if (GetAsyncKeyState(VK_ESCAPE) & 0x8000) {
+        return false;
+    }
+#else
+    // Handle input for Unix systems
+    char c = 0;  // Initialize to avoid undefined behavior
+    
+    // Make input non-blocking for Unix/WSL2
+    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
+    if (flags != -1) {
+        fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    }
+    
+    // Check for input
+    while (read(STDIN_FILENO, &c, 1) > 0) {
+        if (c == 't') {
+            // Write the timeline recorded so far
+            dumpTrace();
+        }
+        if (c == 'm') {
+            // Zoom the mini-map out, back in after the whole map
+            cycleMiniMapZoom();
+        }
+        if (netClient) {
+            // The server moves the player
+            queueInputKey(*netClient, c);
+        } else {
+            applyKey(c, fElapsedTime);
+        }
+        if (c == ' ') {
+            // Add a small delay to prevent multiple shots
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    
+    // Handle ESC key separately
+    if (c == 27) {
+        return false;
+    }
+#endif  // Close the platform-specific input handling block
+    
+    return true;
+}
+
+int main(int argc, char** argv) {
+    GameOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    if (options.headless) {
+        return runHeadless(options);
+    }
+    if (options.serverPort > 0) {
+        return runServer(options);
+    }
+    if (options.bots.maxBots > 0) {
+        return runBots(options);
+    }
+    
+    // Join a server before touching the terminal, so errors stay readable
+    NetClient client;
+    if (!options.connectTo.empty()) {
+        NetAddress address;
+        std::string error;
+        if (!parseAddress(options.connectTo, address)) {
+            std::cerr << "bad server address " << options.connectTo << std::endl;
+            return 1;
+        }
+        if (!startClient(client, address, error)) {
+            std::cerr << "cannot connect: " << error << std::endl;
+            return 1;
+        }
+        netClient = &client;
+    }
+    
+    if (!startInstrumentation(options)) {
+        return 1;
+    }
+    SpectatorServer spectators;
+    if (!startSpectating(options, spectators)) {
+        return 1;
+    }
+    
+    // Initialize game
+    initGame();
+    if (netClient) {
+        debugOutput = false;
+    }
+    
+#ifdef PLATFORM_WINDOWS
+    // Create screen buffer
+    wchar_t* screen = new wchar_t[SCREEN_WIDTH * SCREEN_HEIGHT];
+    HANDLE console = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, 0, NULL, CONSOLE_TEXTMODE_BUFFER, NULL);
+    
+    // Check if console creation was successful
+    if (console == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error creating console buffer: " << GetLastError() << std::endl;
+        delete[] screen;
+        return 1;
+    }
+    
+    SetConsoleActiveScreenBuffer(console);
+    DWORD bytesWritten = 0;
+#endif
+    
+    // Framebuffer the renderer draws into
+    FrameBuffer frame;
+    frame.resize(SCREEN_WIDTH, SCREEN_HEIGHT);
+    
+    // Game loop variables
+    auto tp1 = std::chrono::system_clock::now();
+    auto tp2 = std::chrono::system_clock::now();
+    
+    const std::chrono::milliseconds FRAME_DURATION(1000 / TARGET_FPS);
+    
+    // Trade picture detail for frame time when the machine cannot keep up
+    FrameGovernor governor;
+    bool governed = startQuality(options, governor, true);
+    
+    // Game loop
+    bool gameRunning = true;
+    long frameNumber = 0;
+    bool allocationFailure = false;
+    const char* connectionError = NULL;
+    FrameStats failedFrame;
+    while (gameRunning) {
+        // Start frame timing
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        beginFrameStats(frameNumber++);
+        
+        // Calculate elapsed time
+        tp2 = std::chrono::system_clock::now();
+        std::chrono::duration<float> elapsedTime = tp2 - tp1;
+        tp1 = tp2;
+        float fElapsedTime = elapsedTime.count();
+        
+        // Handle input
+        {
+            StageTimer timer(STAGE_INPUT);
+            gameRunning = handleInput(fElapsedTime);
+        }
+        
+        // Update bullets, or send the input and take the world from the server
+        {
+            StageTimer timer(STAGE_UPDATE);
+            if (netClient) {
+                ClientStats before = netClient->stats;
+                sendInput(*netClient);
+                pollClient(*netClient);
+                applySnapshot(*netClient);
+                const ClientStats& after = netClient->stats;
+                currentFrame.networked = true;
+                currentFrame.corrections = (int)(after.corrections - before.corrections);
+                if (after.reconciliations != before.reconciliations) {
+                    currentFrame.predictionError = after.lastPredictionError;
+                }
+                connectionError = connectionProblem(*netClient, frameNumber);
+                if (connectionError) {
+                    gameRunning = false;
+                }
+            } else {
+                updateBullets(fElapsedTime);
+            }
+        }
+        
+        // Render
+#ifdef PLATFORM_WINDOWS
+        renderScene(frame);
+        
+        // Display frame
+        for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+            screen[i] = frame.cells[i];
+        }
+        screen[SCREEN_WIDTH * SCREEN_HEIGHT - 1] = '\0';
+        {
+            StageTimer timer(STAGE_WRITE);
+            WriteConsoleOutputCharacter(console, screen, SCREEN_WIDTH * SCREEN_HEIGHT, { 0, 0 }, &bytesWritten);
+            currentFrame.syscalls++;
+            currentFrame.bytesWritten += bytesWritten * sizeof(wchar_t);
+        }
+#else
+        // Adjust screen dimensions if terminal is too small
+        int termWidth, termHeight;
+        getTerminalSize(termWidth, termHeight);
+        frame.resize(std::min<int>(SCREEN_WIDTH, termWidth), std::min<int>(SCREEN_HEIGHT, termHeight));
+        
+        renderScene(frame);
+        if (spectators.listenFd >= 0) {
+            // Before presenting: the viewers' diff needs the frame's dirty spans
+            StageTimer timer(STAGE_WRITE);
+            broadcastFrame(spectators, frame);
+        }
+        presentFrame(frame);
+#endif
+        
+        endFrameStats(options.budgetMs);
+        if (governed) {
+            updateGovernor(governor, currentFrame.frameMs);
+        }
+        
+        // Frame rate control
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        auto frameDuration = std::chrono::duration_cast<std::chrono::milliseconds>(frameEnd - frameStart);
+        if (frameDuration < FRAME_DURATION) {
+            StageTimer timer(STAGE_SLEEP);
+            std::this_thread::sleep_for(FRAME_DURATION - frameDuration);
+        }
+        recordFrameMetrics(currentFrame);
+        
+        if (steadyStateAllocated(options, currentFrame)) {
+            failedFrame = currentFrame;
+            allocationFailure = true;
+            gameRunning = false;
+        }
+    }
+    
+    stopInstrumentation();
+    stopSpectators(spectators);
+    if (netClient) {
+        stopClient(*netClient);
+    }
+    
+    // Clean up
+#ifdef PLATFORM_WINDOWS
+    delete[] screen;
+    CloseHandle(console);
+#else
+    restoreTerminal();
+#endif
+    
+    printSpectatorSummary(spectators);
+    if (netClient && netClient->stats.reconciliations > 0) {
+        const ClientStats& stats = netClient->stats;
+        std::printf("prediction: %lu corrections in %lu snapshots, mean error %.4f cells, worst %.4f\n",
+                    stats.corrections, stats.reconciliations, stats.predictionErrorSum / stats.reconciliations,
+                    stats.predictionErrorMax);
+    }
+    
+    if (connectionError) {
+        std::cerr << "left the game: " << connectionError << std::endl;
+        return 1;
+    }
+    
+    if (allocationFailure) {
+        reportFrameAllocations(failedFrame);
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "alloc_track.h"
+#include "profile.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Slot STAGE_COUNT holds ALLOC_PHASE_OTHER
+static std::atomic<unsigned long> phaseCount[STAGE_COUNT + 1];
+static std::atomic<unsigned long> phaseBytes[STAGE_COUNT + 1];
+static std::atomic<unsigned long> totalFrees(0);
+
+static thread_local int allocPhase = ALLOC_PHASE_OTHER;
+
+// The same counts for the calling thread alone, so a frame is not charged
+// for what background threads allocate meanwhile
+static thread_local unsigned long threadCount[STAGE_COUNT + 1];
+static thread_local unsigned long threadBytes[STAGE_COUNT + 1];
+
+static inline int phaseSlot(int phase) {
+    return phase >= 0 && phase < STAGE_COUNT ? phase : STAGE_COUNT;
+}
+
+// Function to count an allocation and get the memory
+static inline void* trackedAlloc(std::size_t size) {
+    int slot = phaseSlot(allocPhase);
+    phaseCount[slot].fetch_add(1, std::memory_order_relaxed);
+    phaseBytes[slot].fetch_add(size, std::memory_order_relaxed);
+    threadCount[slot]++;
+    threadBytes[slot] += size;
+    return std::malloc(size ? size : 1);
+}
+
+static inline void trackedFree(void* ptr) {
+    if (!ptr) return;
+    totalFrees.fetch_add(1, std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+// Function to get the totals since program start
+AllocCounters allocationTotals() {
+    AllocCounters totals = { 0, 0, totalFrees.load(std::memory_order_relaxed) };
+    for (int i = 0; i <= STAGE_COUNT; i++) {
+        totals.count += phaseCount[i].load(std::memory_order_relaxed);
+        totals.bytes += phaseBytes[i].load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+// Function to get the totals for one stage
+AllocCounters allocationsInPhase(int phase) {
+    int slot = phaseSlot(phase);
+    AllocCounters counters = {
+        phaseCount[slot].load(std::memory_order_relaxed),
+        phaseBytes[slot].load(std::memory_order_relaxed),
+        0
+    };
+    return counters;
+}
+
+// Function to get the calling thread's totals since it started
+AllocCounters threadAllocationTotals() {
+    AllocCounters totals = { 0, 0, 0 };
+    for (int i = 0; i <= STAGE_COUNT; i++) {
+        totals.count += threadCount[i];
+        totals.bytes += threadBytes[i];
+    }
+    return totals;
+}
+
+// Function to get the calling thread's totals for one stage
+AllocCounters threadAllocationsInPhase(int phase) {
+    int slot = phaseSlot(phase);
+    AllocCounters counters = { threadCount[slot], threadBytes[slot], 0 };
+    return counters;
+}
+
+// Function to set the calling thread's phase
+int setAllocPhase(int phase) {
+    int previous = allocPhase;
+    allocPhase = phase;
+    return previous;
+}
+
+// Global replacements, every new/delete in the program goes through these
+
+void* operator new(std::size_t size) {
+    void* ptr = trackedAlloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = trackedAlloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    trackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    trackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    trackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    trackedFree(ptr);
+}
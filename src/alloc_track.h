@@ -0,0 +1,34 @@
+#ifndef ALLOC_TRACK_H
+#define ALLOC_TRACK_H
+
+// Heap allocation counters, fed by the global operator new/delete
+// replacements in alloc_track.cpp. Allocations are attributed to the frame
+// stage the allocating thread is in (see StageTimer); anything outside a
+// stage counts under ALLOC_PHASE_OTHER.
+
+struct AllocCounters {
+    unsigned long count;  // Calls to operator new
+    unsigned long bytes;  // Bytes requested
+    unsigned long frees;  // Calls to operator delete with a non-null pointer
+};
+
+// Phase index for allocations made outside any stage
+const int ALLOC_PHASE_OTHER = -1;
+
+// Function to get the totals since program start, over all threads
+AllocCounters allocationTotals();
+
+// Function to get the totals for one stage (or ALLOC_PHASE_OTHER)
+AllocCounters allocationsInPhase(int phase);
+
+// Function to get the calling thread's totals since it started; frees are
+// not counted per thread
+AllocCounters threadAllocationTotals();
+
+// Function to get the calling thread's totals for one stage
+AllocCounters threadAllocationsInPhase(int phase);
+
+// Function to set the calling thread's phase, returns the previous one
+int setAllocPhase(int phase);
+
+#endif // ALLOC_TRACK_H
@@ -0,0 +1,221 @@
+#include "bots.h"
+#include "platform.h"
+#include "profile.h"
+#include "server.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef PLATFORM_UNIX
+#include <poll.h>
+#endif
+
+// Function to pick the keys a scripted bot holds on a tick
+InputCommand scriptedInput(int bot, unsigned int tick) {
+    unsigned int phase = (tick + bot * 7) % 60;
+    if (phase < 30) return inputBit('w');
+    if (phase < 40) return inputBit('w') | inputBit('q');
+    if (phase < 50) return inputBit('e');
+    if (phase == 50) return inputBit(' ');
+    return 0;
+}
+
+#ifdef PLATFORM_UNIX
+
+// One simulated player: a client that never decodes the world, and when
+// each of its inputs went out
+struct Bot {
+    NetClient client;
+    double sentMs[PREDICTION_BUFFER]; // By input sequence number
+    unsigned int measuredAck;         // Newest input whose latency was taken
+    InputCommand walking;             // Random walk: keys held
+    int walkTicks;                    // Random walk: ticks left to hold them
+    unsigned int seed;
+    
+    Bot() : measuredAck(0), walking(0), walkTicks(0), seed(0) {
+        for (int i = 0; i < PREDICTION_BUFFER; i++) sentMs[i] = 0.0;
+    }
+};
+
+// Function to get the next number of a bot's own generator
+static unsigned int nextRandom(unsigned int& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+// Function to pick the keys a random-walking bot holds on a tick
+static InputCommand randomWalkInput(Bot& bot) {
+    static const char* const MOVES[] = { "w", "wq", "we", "s", "a", "d", "q", "e" };
+    if (bot.walkTicks-- <= 0) {
+        const char* keys = MOVES[nextRandom(bot.seed) % (sizeof(MOVES) / sizeof(MOVES[0]))];
+        bot.walking = 0;
+        for (const char* k = keys; *k; k++) bot.walking |= inputBit(*k);
+        bot.walkTicks = NET_TICK_RATE / 2 + (int)(nextRandom(bot.seed) % (NET_TICK_RATE * 2));
+    }
+    InputCommand command = bot.walking;
+    if (nextRandom(bot.seed) % NET_TICK_RATE == 0) command |= inputBit(' ');
+    return command;
+}
+
+// Function to take the latency of every input a snapshot confirmed for the first time
+static void measureAcks(Bot& bot, double now, std::vector<double>& latencies) {
+    const NetClient& c = bot.client;
+    if (c.inputAcked <= bot.measuredAck) return;
+    for (unsigned int seq = bot.measuredAck + 1; seq <= c.inputAcked; seq++) {
+        if (c.inputSeq - seq < (unsigned int)PREDICTION_BUFFER) latencies.push_back(now - bot.sentMs[seq % PREDICTION_BUFFER]);
+    }
+    bot.measuredAck = c.inputAcked;
+}
+
+// Function to get a percentile of samples, reordering them; 0 without samples
+static double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) return 0.0;
+    size_t k = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+// What one stage measured
+struct StageTotals {
+    double serverMs;       // Server tick time, in-process server only
+    double serverMaxMs;
+    unsigned long ticks;
+    unsigned long bytesDown, bytesUp, snapshots;
+    std::vector<double> latencies;
+    
+    void reset() {
+        serverMs = serverMaxMs = 0.0;
+        ticks = bytesDown = bytesUp = snapshots = 0;
+        latencies.clear();
+    }
+};
+
+// Function to print the line of a finished stage
+static void reportStage(FILE* out, const std::vector<Bot>& bots, StageTotals& stage, bool ownServer) {
+    int connected = 0, rejected = 0;
+    for (size_t i = 0; i < bots.size(); i++) {
+        connected += bots[i].client.state == CLIENT_CONNECTED;
+        rejected += bots[i].client.state == CLIENT_REJECTED;
+    }
+    double seconds = (double)stage.ticks / NET_TICK_RATE;
+    double perBot = connected > 0 ? seconds * connected : 1.0;
+    char tick[32] = "-";
+    if (ownServer) std::snprintf(tick, sizeof(tick), "%.3f/%.3f", stage.serverMs / stage.ticks, stage.serverMaxMs);
+    std::fprintf(out, "%6d %9d %8d %15s %10.2f %8.2f %8.1f %8.1f %8.1f %8.1f\n", (int)bots.size(), connected, rejected, tick,
+                 stage.bytesDown / perBot / 1024.0, stage.bytesUp / perBot / 1024.0, stage.snapshots / perBot,
+                 percentile(stage.latencies, 0.50), percentile(stage.latencies, 0.95), percentile(stage.latencies, 0.99));
+    std::fflush(out);
+}
+
+// Function to take packets as they come until a deadline; a loop running
+// late still looks once
+static void receiveUntil(std::vector<Bot>& bots, std::vector<pollfd>& polls, double deadline, StageTotals& stage) {
+    do {
+        int timeout = std::max(0, (int)(deadline - nowMs()));
+        if (polls.empty() || poll(&polls[0], polls.size(), timeout) <= 0) continue;
+        double arrived = nowMs();
+        for (size_t i = 0; i < polls.size(); i++) {
+            if (!(polls[i].revents & POLLIN)) continue;
+            Bot& bot = bots[i];
+            unsigned long received = bot.client.socket.bytesReceived;
+            stage.snapshots += pollClient(bot.client);
+            stage.bytesDown += bot.client.socket.bytesReceived - received;
+            measureAcks(bot, arrived, stage.latencies);
+        }
+    } while (nowMs() < deadline);
+}
+
+// Function to disconnect every bot and stop the server they played on, if it is ours
+static void stopBots(std::vector<Bot>& bots, GameServer& server, bool ownServer) {
+    for (size_t i = 0; i < bots.size(); i++) stopClient(bots[i].client);
+    if (ownServer) stopServer(server);
+}
+
+// Function to run bots against a server, a batch more every stage
+bool runBotLoad(const BotLoadOptions& options, FILE* out, std::string& error) {
+    GameServer server;
+    NetAddress address;
+    bool ownServer = options.connectTo.empty();
+    if (ownServer) {
+        if (!startServer(server, 0, error)) return false;
+        address = NetAddress(0x7F000001, boundPort(server.socket));
+    } else if (!parseAddress(options.connectTo, address)) {
+        error = "bad server address " + options.connectTo;
+        return false;
+    }
+    
+    std::vector<Bot> bots;
+    bots.reserve(options.maxBots);
+    std::vector<pollfd> polls;
+    StageTotals stage;
+    stage.reset();
+    const int ramp = std::max(1, options.ramp);
+    const int stageTicks = std::max(1, (int)(options.stageSeconds * NET_TICK_RATE));
+    const double TICK_MS = 1000.0 / NET_TICK_RATE;
+    
+    std::fprintf(out, "%6s %9s %8s %15s %10s %8s %8s %8s %8s %8s\n", "bots", "connected", "rejected", "tick ms avg/max",
+                 "down KB/s", "up KB/s", "snaps/s", "p50 ms", "p95 ms", "p99 ms");
+    double nextTick = nowMs();
+    for (unsigned int t = 0;; t++) {
+        // A new stage: report the last one and bring in the next batch
+        if (t % stageTicks == 0) {
+            if (t > 0) reportStage(out, bots, stage, ownServer);
+            if ((int)bots.size() >= options.maxBots) break;
+            stage.reset();
+            int add = std::min(ramp, options.maxBots - (int)bots.size());
+            for (int i = 0; i < add; i++) {
+                bots.push_back(Bot());
+                Bot& bot = bots.back();
+                bot.client.decode = false;
+                bot.seed = 2654435761u * (unsigned int)bots.size();
+                if (!startClient(bot.client, address, error)) {
+                    bots.pop_back();
+                    stopBots(bots, server, ownServer);
+                    return false;
+                }
+                pollfd p = { bot.client.socket.fd, POLLIN, 0 };
+                polls.push_back(p);
+            }
+        }
+        
+        // Every bot sends its input
+        double now = nowMs();
+        for (size_t i = 0; i < bots.size(); i++) {
+            Bot& bot = bots[i];
+            unsigned long sent = bot.client.socket.bytesSent;
+            bot.client.pending = options.behaviour == BOTS_RANDOM_WALK ? randomWalkInput(bot) : scriptedInput((int)i, t);
+            sendInput(bot.client);
+            bot.sentMs[bot.client.inputSeq % PREDICTION_BUFFER] = now;
+            stage.bytesUp += bot.client.socket.bytesSent - sent;
+        }
+        
+        // The server runs half a tick later, so inputs wait for its clock as
+        // they would for a server elsewhere
+        receiveUntil(bots, polls, nextTick + TICK_MS / 2, stage);
+        if (ownServer) {
+            double before = server.stats.tickMs;
+            serverTick(server);
+            double tickMs = server.stats.tickMs - before;
+            stage.serverMs += tickMs;
+            stage.serverMaxMs = std::max(stage.serverMaxMs, tickMs);
+        }
+        stage.ticks++;
+        
+        nextTick += TICK_MS;
+        if (nowMs() > nextTick + 10 * TICK_MS) nextTick = nowMs(); // Too far behind to catch up
+        receiveUntil(bots, polls, nextTick, stage);
+    }
+    
+    stopBots(bots, server, ownServer);
+    return true;
+}
+
+#else
+
+// The bots need BSD sockets, like the rest of the multiplayer code
+bool runBotLoad(const BotLoadOptions&, FILE*, std::string& error) {
+    error = "bots are only available on Linux/Unix";
+    return false;
+}
+
+#endif
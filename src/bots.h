@@ -0,0 +1,37 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include "client.h"
+
+#include <cstdio>
+#include <string>
+
+// How bots pick their keys
+enum BotBehaviour {
+    BOTS_SCRIPTED,   // A fixed loop of running, turning and shooting
+    BOTS_RANDOM_WALK // Hold a random direction for a second or two, now and then shoot
+};
+
+// Load generator settings
+struct BotLoadOptions {
+    int maxBots;           // Bots in the last stage
+    int ramp;              // Bots added per stage
+    double stageSeconds;   // Length of one stage
+    BotBehaviour behaviour;
+    std::string connectTo; // Server at host:port, empty to run one in the process
+    
+    BotLoadOptions() : maxBots(0), ramp(0), stageSeconds(5.0), behaviour(BOTS_SCRIPTED) {}
+};
+
+// Function to pick the keys a scripted bot holds on a tick: runs, turns
+// while running, turns on the spot and fires now and then
+InputCommand scriptedInput(int bot, unsigned int tick);
+
+// Function to run bots against a server with no rendering, adding a batch
+// every stage, and print a line per stage with the server tick time (when
+// the server runs in the process), bandwidth per bot and the time from
+// sending an input to the snapshot that confirms it. Returns false and sets
+// error when the server or a bot cannot be started.
+bool runBotLoad(const BotLoadOptions& options, FILE* out, std::string& error);
+
+#endif // BOTS_H
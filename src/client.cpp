@@ -0,0 +1,312 @@
+#include "client.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Function to open a socket and start connecting to a server
+bool startClient(NetClient& client, const NetAddress& server, std::string& error) {
+    if (!openUdp(client.socket, 0, error)) return false;
+    client.server = server;
+    client.state = CLIENT_CONNECTING;
+    client.slot = -1;
+    client.inputSeq = 0;
+    client.pending = 0;
+    for (int i = 0; i < NET_INPUT_REDUNDANCY; i++) client.recent[i] = 0;
+    client.history.clear();
+    client.latestTick = 0;
+    client.inputAcked = 0;
+    for (int i = 0; i < PREDICTION_BUFFER; i++) client.commands[i] = 0;
+    client.predicting = false;
+    client.latestArrivalMs = 0.0;
+    client.renderTick = 0.0;
+    client.renderClockMs = 0.0;
+    client.in.resize(NET_MAX_PACKET);
+    client.stats = ClientStats();
+    return true;
+}
+
+// Function to run sent commands on the predicted player through the game's
+// movement code, the way the server runs them on its player
+static void predict(NetClient& client, unsigned int firstSeq, unsigned int lastSeq) {
+    float x = playerX, y = playerY, a = playerA;
+    playerX = client.predictedX;
+    playerY = client.predictedY;
+    playerA = client.predictedA;
+    for (unsigned int seq = firstSeq; seq <= lastSeq; seq++) {
+        // Shots are the server's to fire; they arrive with the snapshots
+        applyInput(client.commands[seq % PREDICTION_BUFFER] & ~inputBit(' '), NET_TICK_SECONDS);
+    }
+    client.predictedX = playerX;
+    client.predictedY = playerY;
+    client.predictedA = playerA;
+    playerX = x;
+    playerY = y;
+    playerA = a;
+}
+
+// Function to send this frame's input command
+void sendInput(NetClient& client) {
+    PacketWriter& out = client.out;
+    if (client.state == CLIENT_CONNECTING) {
+        beginPacket(out, PACKET_CONNECT);
+        sendPacket(client.socket, client.server, &out.data[0], out.size());
+        return;
+    }
+    if (client.state != CLIENT_CONNECTED) return;
+    
+    for (int i = NET_INPUT_REDUNDANCY - 1; i > 0; i--) {
+        client.recent[i] = client.recent[i - 1];
+    }
+    client.recent[0] = client.pending;
+    client.pending = 0;
+    client.inputSeq++;
+    client.commands[client.inputSeq % PREDICTION_BUFFER] = client.recent[0];
+    if (client.predicting) predict(client, client.inputSeq, client.inputSeq);
+    
+    int count = (int)std::min<unsigned int>(client.inputSeq, NET_INPUT_REDUNDANCY);
+    beginPacket(out, PACKET_INPUT);
+    out.u32(client.latestTick);
+    out.u32(client.inputSeq);
+    out.u8(count);
+    for (int i = 0; i < count; i++) {
+        out.u8(client.recent[i]);
+    }
+    if (sendPacket(client.socket, client.server, &out.data[0], out.size())) client.stats.inputsSent++;
+}
+
+// Function to decode a snapshot into the history, returns true if it is new
+static bool readSnapshot(NetClient& client, PacketReader& r) {
+    unsigned int tick = r.u32();
+    unsigned int baseTick = r.u32();
+    unsigned int inputAcked = r.u32();
+    if (!r.ok || tick == 0) return false;
+    
+    // Datagrams can arrive out of order; an older snapshot adds nothing
+    if (tick <= client.latestTick) {
+        client.stats.staleSnapshots++;
+        return false;
+    }
+    
+    // The server deltas against whatever tick is acked; it does not need
+    // the client to hold that world
+    if (!client.decode) {
+        client.latestTick = tick;
+        client.latestArrivalMs = nowMs();
+        client.inputAcked = inputAcked;
+        client.stats.snapshots++;
+        return true;
+    }
+    const Snapshot* base = NULL;
+    if (baseTick != 0) {
+        base = client.history.find(baseTick);
+        if (!base || baseTick % SNAPSHOT_HISTORY == tick % SNAPSHOT_HISTORY) {
+            client.stats.missingBase++;
+            return false;
+        }
+    }
+    
+    Snapshot& s = client.history.slotFor(tick);
+    s.tick = 0;
+    if (!decodeSnapshotDelta(base, r, s)) return false;
+    s.tick = tick;
+    client.latestTick = tick;
+    client.latestArrivalMs = nowMs();
+    client.inputAcked = inputAcked;
+    client.stats.snapshots++;
+    return true;
+}
+
+// Function to start the predicted player from where the newest snapshot has
+// it and replay the commands the server had not applied yet
+static void reconcile(NetClient& client) {
+    const Snapshot* s = latestSnapshot(client);
+    const EntityState* self = s ? findEntity(*s, playerEntityId(client.slot)) : NULL;
+    if (!self) return;
+    
+    float x = client.predictedX, y = client.predictedY, a = client.predictedA;
+    client.predictedX = dequantizePosition(self->x);
+    client.predictedY = dequantizePosition(self->y);
+    client.predictedA = dequantizeAngle(self->angle);
+    unsigned int unacked = client.inputSeq - std::min(client.inputAcked, client.inputSeq);
+    if (unacked > 0 && unacked < (unsigned int)PREDICTION_BUFFER) {
+        predict(client, client.inputSeq - unacked + 1, client.inputSeq);
+    }
+    if (!client.predicting) {
+        client.predicting = true;
+        return;
+    }
+    
+    float dx = client.predictedX - x, dy = client.predictedY - y;
+    float error = std::sqrt(dx * dx + dy * dy);
+    float turn = std::fabs(std::remainder(client.predictedA - a, 6.28318531f));
+    ClientStats& stats = client.stats;
+    stats.reconciliations++;
+    stats.predictionErrorSum += error;
+    stats.predictionErrorMax = std::max(stats.predictionErrorMax, error);
+    stats.lastPredictionError = error;
+    if (error > CORRECTION_DISTANCE || turn > CORRECTION_ANGLE || unacked >= (unsigned int)PREDICTION_BUFFER) {
+        stats.corrections++;
+        return;
+    }
+    
+    // Close enough: keep the prediction rather than jitter by the quantisation
+    client.predictedX = x;
+    client.predictedY = y;
+    client.predictedA = a;
+}
+
+// Function to read every waiting packet
+int pollClient(NetClient& client) {
+    int snapshots = 0;
+    NetAddress from;
+    int size;
+    while ((size = receivePacket(client.socket, from, &client.in[0], (int)client.in.size())) >= 0) {
+        if (!(from == client.server)) continue;
+        PacketReader r(&client.in[0], size);
+        int type = readPacketType(r);
+        if (type == PACKET_WELCOME && client.state == CLIENT_CONNECTING) {
+            client.slot = (int)r.u8();
+            if (r.ok) client.state = CLIENT_CONNECTED;
+        } else if (type == PACKET_REJECT && client.state == CLIENT_CONNECTING) {
+            client.state = CLIENT_REJECTED;
+        } else if (type == PACKET_SNAPSHOT && client.state == CLIENT_CONNECTED) {
+            if (readSnapshot(client, r)) snapshots++;
+        } else if (type == PACKET_DISCONNECT) {
+            client.state = CLIENT_DISCONNECTED;
+        }
+    }
+    if (snapshots > 0) reconcile(client);
+    return snapshots;
+}
+
+// Function to get the newest decoded snapshot, NULL before the first one
+const Snapshot* latestSnapshot(const NetClient& client) {
+    return client.history.find(client.latestTick);
+}
+
+// Function to move the time other entities are drawn at along with the
+// clock, easing it towards INTERPOLATION_DELAY_TICKS behind the newest
+// snapshot so late or early packets do not make it jump
+static void advanceRenderTick(NetClient& client) {
+    const double TICK_MS = 1000.0 / NET_TICK_RATE;
+    double now = nowMs();
+    double target = client.latestTick + (now - client.latestArrivalMs) / TICK_MS - INTERPOLATION_DELAY_TICKS;
+    if (client.renderClockMs == 0.0 || std::fabs(target - client.renderTick) > INTERPOLATION_DELAY_TICKS) {
+        client.renderTick = target;
+    } else {
+        client.renderTick += (now - client.renderClockMs) / TICK_MS;
+        client.renderTick += (target - client.renderTick) * 0.1;
+    }
+    client.renderClockMs = now;
+    client.renderTick = std::min(client.renderTick, (double)client.latestTick);
+}
+
+// Function to blend two quantized positions
+static inline float blendPosition(unsigned short from, unsigned short to, float t) {
+    return dequantizePosition(from) + (dequantizePosition(to) - dequantizePosition(from)) * t;
+}
+
+// Function to blend two quantized angles the short way round
+static inline float blendAngle(unsigned short from, unsigned short to, float t) {
+    return dequantizeAngle(from) + (short)(unsigned short)(to - from) * t / ANGLE_SCALE;
+}
+
+// Function to put the predicted player and the interpolated world into the game's globals
+void applySnapshot(NetClient& client) {
+    const Snapshot* newest = latestSnapshot(client);
+    if (!newest) return;
+    if (client.predicting) {
+        playerX = client.predictedX;
+        playerY = client.predictedY;
+        playerA = client.predictedA;
+    }
+    
+    // The snapshots either side of the render time; past the newest, or
+    // before the oldest kept, the world stands still
+    advanceRenderTick(client);
+    const Snapshot* from = NULL;
+    const Snapshot* to = NULL;
+    for (unsigned int k = 0; k < (unsigned int)SNAPSHOT_HISTORY && k < client.latestTick; k++) {
+        const Snapshot* s = client.history.find(client.latestTick - k);
+        if (!s) continue;
+        if (s->tick > client.renderTick) {
+            to = s;
+        } else {
+            from = s;
+            break;
+        }
+    }
+    if (!to) to = from ? from : newest;
+    if (!from) from = to;
+    float blend = from == to ? 1.0f : (float)((client.renderTick - from->tick) / (to->tick - from->tick));
+    
+    // Every enemy the snapshot leaves out is dead, or out of the player's sight
+    static std::vector<char> seen;
+    bool resized = false;
+    bool killed = false;
+    seen.assign(enemies.size(), 0);
+    remotePlayers.clear();
+    int bulletCount = 0;
+    for (size_t i = 0; i < to->entities.size(); i++) {
+        const EntityState& e = to->entities[i];
+        const EntityState* before = from == to ? NULL : findEntity(*from, e.id);
+        if (!before) before = &e;
+        float x = blendPosition(before->x, e.x, blend);
+        float y = blendPosition(before->y, e.y, blend);
+        float a = blendAngle(before->angle, e.angle, blend);
+        if (e.kind == ENTITY_PLAYER) {
+            if (e.id != playerEntityId(client.slot)) {
+                RemotePlayer p = { x, y, a };
+                remotePlayers.push_back(p);
+            }
+        } else if (e.kind == ENTITY_ENEMY) {
+            int index = enemyOfEntity(e.id);
+            if (index < 0) continue;
+            if (index >= (int)enemies.size()) {
+                enemies.resize(index + 1, Enemy(x, y));
+                seen.resize(index + 1, 0);
+                resized = true;
+            }
+            Enemy& enemy = enemies[index];
+            if (enemy.x != x || enemy.y != y) resized = true;
+            enemy.x = x;
+            enemy.y = y;
+            seen[index] = 1;
+        } else if (e.kind == ENTITY_BULLET) {
+            // Bullets fly straight, so the trail is where it was the last few ticks
+            if (bulletCount >= (int)bullets.size()) bullets.resize(bulletCount + 1);
+            Bullet& b = bullets[bulletCount++];
+            b.x = x;
+            b.y = y;
+            b.dx = std::sin(a) * bulletSpeed;
+            b.dy = std::cos(a) * bulletSpeed;
+            b.active = true;
+            for (int t = 0; t < BULLET_TRAIL_LENGTH; t++) {
+                b.trailX[t] = x - b.dx * t / NET_TICK_RATE;
+                b.trailY[t] = y - b.dy * t / NET_TICK_RATE;
+            }
+        }
+    }
+    for (size_t i = bulletCount; i < bullets.size(); i++) {
+        bullets[i].active = false;
+    }
+    activeBullets = bulletCount;
+    
+    for (size_t i = 0; i < enemies.size(); i++) {
+        if (enemies[i].alive != (seen[i] != 0)) killed = true;
+        enemies[i].alive = seen[i] != 0;
+    }
+    if (resized) indexEnemies();
+    else if (killed) enemyIndex.version++;
+}
+
+// Function to tell the server the client leaves and close the socket
+void stopClient(NetClient& client) {
+    if (client.state == CLIENT_CONNECTED) {
+        beginPacket(client.out, PACKET_DISCONNECT);
+        sendPacket(client.socket, client.server, &client.out.data[0], client.out.size());
+    }
+    client.state = CLIENT_IDLE;
+    closeUdp(client.socket);
+}
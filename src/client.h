@@ -0,0 +1,109 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include "game.h"
+#include "net.h"
+#include "snapshot.h"
+
+#include <string>
+#include <vector>
+
+// Input commands kept for replaying after a correction, about two seconds
+const int PREDICTION_BUFFER = 64;
+
+// Ticks other entities are drawn behind the newest snapshot, so there is
+// usually a newer one to move them towards
+const int INTERPOLATION_DELAY_TICKS = 2;
+
+// How far the server may put the player from where the client predicted it
+// before that counts as a correction; quantisation alone stays well below
+const float CORRECTION_DISTANCE = 0.01f; // Cells
+const float CORRECTION_ANGLE = 0.01f;    // Radians
+
+// Connection state of a client
+enum ClientState {
+    CLIENT_IDLE,
+    CLIENT_CONNECTING,
+    CLIENT_CONNECTED,
+    CLIENT_REJECTED,   // The server was full
+    CLIENT_DISCONNECTED // The server went away
+};
+
+// Totals since the client connected
+struct ClientStats {
+    unsigned long snapshots;     // Snapshots decoded
+    unsigned long staleSnapshots; // Older than one already decoded, dropped
+    unsigned long missingBase;   // Deltas against a snapshot the client no longer has
+    unsigned long inputsSent;
+    unsigned long reconciliations; // Snapshots the predicted player was checked against
+    unsigned long corrections;     // Of those, ones that moved the player
+    double predictionErrorSum;     // Cells between prediction and server, over all reconciliations
+    float predictionErrorMax;
+    float lastPredictionError;     // Of the newest reconciliation
+    
+    ClientStats() : snapshots(0), staleSnapshots(0), missingBase(0), inputsSent(0), reconciliations(0), corrections(0),
+                    predictionErrorSum(0.0), predictionErrorMax(0.0f), lastPredictionError(0.0f) {}
+};
+
+// Client end of a network game: sends one input command per frame and keeps
+// the snapshots the server sends back. The own player is predicted by
+// running each command locally as it is sent; when a snapshot says which
+// commands the server applied, the commands after those are replayed from
+// the server's position. Everything else is drawn a little in the past,
+// between the two snapshots around that moment.
+struct NetClient {
+    UdpSocket socket;
+    NetAddress server;
+    ClientState state;
+    bool decode;                                // False to only read snapshot headers and ack them, for load bots
+    int slot;
+    unsigned int inputSeq;                      // Sequence number of the newest command sent
+    InputCommand pending;                       // Keys pressed since the last command
+    InputCommand recent[NET_INPUT_REDUNDANCY];  // Last commands sent, newest first
+    SnapshotHistory history;                    // Recently decoded snapshots, the baselines
+    unsigned int latestTick;                    // Newest snapshot decoded, 0 for none
+    unsigned int inputAcked;                    // Newest command the server has applied
+    InputCommand commands[PREDICTION_BUFFER];   // Commands sent, by sequence number
+    bool predicting;                            // The predicted player has been placed by a snapshot
+    float predictedX, predictedY, predictedA;
+    double latestArrivalMs;                     // When the newest snapshot arrived
+    double renderTick;                          // Server time other entities are drawn at, in ticks
+    double renderClockMs;                       // When renderTick was last advanced
+    std::vector<unsigned char> in;
+    PacketWriter out;
+    ClientStats stats;
+    
+    NetClient() : state(CLIENT_IDLE), decode(true), slot(-1), inputSeq(0), pending(0), latestTick(0), inputAcked(0), predicting(false),
+                  predictedX(0), predictedY(0), predictedA(0), latestArrivalMs(0.0), renderTick(0.0), renderClockMs(0.0) {}
+};
+
+// Function to open a socket and start connecting to a server, returns false
+// and sets error when the socket cannot be opened
+bool startClient(NetClient& client, const NetAddress& server, std::string& error);
+
+// Function to add a key to the command sent with the next input
+inline void queueInputKey(NetClient& client, char key) {
+    client.pending |= inputBit(key);
+}
+
+// Function to send this frame's input command with the last few before it
+// and the newest snapshot received, and move the predicted player by it;
+// while connecting, asks for a slot again
+void sendInput(NetClient& client);
+
+// Function to read every waiting packet, returns how many new snapshots were
+// decoded; the predicted player is reconciled with the newest
+int pollClient(NetClient& client);
+
+// Function to get the newest decoded snapshot, NULL before the first one
+const Snapshot* latestSnapshot(const NetClient& client);
+
+// Function to put the predicted player into the game's player, and enemies,
+// bullets and other players (into remotePlayers) as they were
+// INTERPOLATION_DELAY_TICKS behind the newest snapshot, so the renderer draws them
+void applySnapshot(NetClient& client);
+
+// Function to tell the server the client leaves and close the socket
+void stopClient(NetClient& client);
+
+#endif // CLIENT_H
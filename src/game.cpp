@@ -0,0 +1,371 @@
+#include "game.h"
+#include "platform.h"
+#include "terminal.h"
+
+#include <iostream>
+#include <cmath>
+
+// Player properties
+float playerX = 8.0f;
+float playerY = 8.0f;
+float playerA = 0.0f; // Player angle
+float playerFOV = 3.14159f / 4.0f; // Field of view
+float playerSpeed = 5.0f; // Movement speed
+float playerRotSpeed = 3.14159f; // Rotation speed
+
+// Map dimensions
+int mapWidth = 16;
+int mapHeight = 16;
+
+// Maximum ray distance
+float maxDepth = 16.0f;
+
+// Game map ('#' = wall, '.' = empty space)
+std::string map;
+unsigned int mapVersion = 0;
+
+// Constant for bullet active message
+const std::string BULLET_ACTIVE_MSG = "!!!!! BULLET ACTIVE !!!!!";
+
+// Bullets
+std::vector<Bullet> bullets;
+float bulletSpeed = 5.0f; // Reduced to make bullets more visible
+
+// Enemies
+std::vector<Enemy> enemies;
+EnemyIndex enemyIndex;
+std::vector<RemotePlayer> remotePlayers;
+
+// Debug counters
+int bulletsFired = 0;
+int activeBullets = 0;
+
+bool debugOutput = true;
+unsigned long debugMessages = 0;
+
+// Function to load the built-in 16x16 map
+void loadDefaultMap() {
+    mapWidth = 16;
+    mapHeight = 16;
+    mapVersion++;
+    
+    map.clear();
+    map += "################";
+    map += "#..............#";
+    map += "#........#.....#";
+    map += "#........#.....#";
+    map += "#..............#";
+    map += "#.......####...#";
+    map += "#..............#";
+    map += "#..............#";
+    map += "#..............#";
+    map += "#..............#";
+    map += "#......##......#";
+    map += "#......##......#";
+    map += "#..............#";
+    map += "#..............#";
+    map += "#..............#";
+    map += "################";
+    indexEnemies();
+}
+
+// Function to generate a bordered map with scattered pillars
+void generateMap(int width, int height, unsigned int seed) {
+    mapWidth = width;
+    mapHeight = height;
+    map.assign(width * height, '.');
+    mapVersion++;
+    
+    // Small xorshift generator so maps are identical on every platform
+    unsigned int state = seed ? seed : 1u;
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+                map[y * width + x] = '#';
+                continue;
+            }
+            
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            
+            // Roughly one cell in eight is a wall
+            if ((state & 7u) == 0) {
+                map[y * width + x] = '#';
+            }
+        }
+    }
+    indexEnemies();
+}
+
+// Function to rebuild the enemy index, call after changing the enemy list or the map size
+void indexEnemies() {
+    EnemyIndex& index = enemyIndex;
+    index.version++;
+    index.columns = (mapWidth + ENEMY_BUCKET_SIZE - 1) / ENEMY_BUCKET_SIZE;
+    index.rows = (mapHeight + ENEMY_BUCKET_SIZE - 1) / ENEMY_BUCKET_SIZE;
+    int buckets = index.columns * index.rows;
+    
+    // Counting sort by bucket; enemies off the map go to the nearest edge bucket
+    std::vector<int> bucketOf(enemies.size());
+    index.start.assign(buckets + 1, 0);
+    for (size_t i = 0; i < enemies.size(); i++) {
+        bucketOf[i] = EnemyIndex::bucket(enemies[i].y, index.rows) * index.columns +
+                      EnemyIndex::bucket(enemies[i].x, index.columns);
+        index.start[bucketOf[i] + 1]++;
+    }
+    for (int b = 0; b < buckets; b++) {
+        index.start[b + 1] += index.start[b];
+    }
+    
+    index.items.resize(enemies.size());
+    std::vector<int> next(index.start.begin(), index.start.end() - 1);
+    for (size_t i = 0; i < enemies.size(); i++) {
+        index.items[next[bucketOf[i]]++] = (int)i;
+    }
+}
+
+// Function to reset player, bullets and enemies without touching the terminal
+void initWorld() {
+    // Initialize map
+    loadDefaultMap();
+    
+    // Initialize player
+    playerX = 8.0f;
+    playerY = 8.0f;
+    playerA = 0.0f;
+    
+    // Initialize bullets
+    bullets.assign(MAX_BULLETS, Bullet());
+    bulletsFired = 0;
+    activeBullets = 0;
+    
+    // Initialize enemies
+    enemies.clear();
+    enemies.push_back(Enemy(10.0f, 10.0f));
+    enemies.push_back(Enemy(5.0f, 5.0f));
+    enemies.push_back(Enemy(12.0f, 3.0f));
+    indexEnemies();
+}
+
+// Function to initialize the game
+void initGame() {
+    initWorld();
+    
+    #ifdef PLATFORM_UNIX
+    initTerminal();
+    #endif
+}
+
+// Function to shoot a bullet
+void shootBullet() {
+    // First check if we have reached the maximum number of bullets
+    if (activeBullets >= MAX_BULLETS) {
+        // Debug message for WSL2
+        #ifdef PLATFORM_UNIX
+        if (debugOutput) {
+            debugMessages++;
+            std::cout << "\033[1;31mMax bullets reached!\033[0m" << std::endl;
+        }
+        #endif
+        return;
+    }
+    
+    for (auto& bullet : bullets) {
+        if (!bullet.active) {
+            bullet.x = playerX;
+            bullet.y = playerY;
+            bullet.dx = sin(playerA) * bulletSpeed;
+            bullet.dy = cos(playerA) * bulletSpeed;
+            bullet.active = true;
+            
+            // Initialize all trail positions to create a visible initial trail
+            for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
+                // Offset slightly to create an immediate visible trail
+                bullet.trailX[i] = bullet.x - (sin(playerA) * 0.1f * i);
+                bullet.trailY[i] = bullet.y - (cos(playerA) * 0.1f * i);
+            }
+            
+            // Debug message and screen flash for WSL2
+            #ifdef PLATFORM_UNIX
+            if (debugOutput) {
+                debugMessages++;
+                // Flash the screen to make the bullet event very noticeable
+                std::cout << "\033[1;41m"; // Bright red background
+                for (int i = 0; i < 5; i++) { // Create 5 blank lines with red background
+                    std::cout << "                          " << BULLET_ACTIVE_MSG << "                          " << std::endl;
+                }
+                std::cout << "\033[0m"; // Reset colors
+                
+                std::cout << "\033[1;31mBullet fired at position (" << bullet.x << ", " << bullet.y 
+                          << ") with direction (" << bullet.dx << ", " << bullet.dy << ")\033[0m" << std::endl;
+            }
+            #endif
+            
+            bulletsFired++;
+            activeBullets++;
+            
+            break;
+        }
+    }
+}
+
+// Function to update bullets
+void updateBullets(float elapsedTime) {
+    // Debug output for WSL2
+    #ifdef PLATFORM_UNIX
+    if (debugOutput && activeBullets > 0) {
+        debugMessages++;
+        std::cout << "\033[1;31mUpdating " << activeBullets << " active bullets\033[0m" << std::endl;
+    }
+    #endif
+    
+    for (auto& bullet : bullets) {
+        if (bullet.active) {
+            // Debug output for WSL2
+            #ifdef PLATFORM_UNIX
+            if (debugOutput) {
+                debugMessages++;
+                std::cout << "\033[1;33mBullet position: (" << bullet.x << ", " << bullet.y << ")\033[0m" << std::endl;
+            }
+            #endif
+            
+            // Update trail positions first (shift all positions)
+            for (int i = BULLET_TRAIL_LENGTH - 1; i > 0; i--) {
+                bullet.trailX[i] = bullet.trailX[i-1];
+                bullet.trailY[i] = bullet.trailY[i-1];
+            }
+            
+            // Store current position as first trail position
+            bullet.trailX[0] = bullet.x;
+            bullet.trailY[0] = bullet.y;
+            
+            // Update position
+            bullet.x += bullet.dx * elapsedTime;
+            bullet.y += bullet.dy * elapsedTime;
+            
+            // Check for collision with walls
+            int mapX = static_cast<int>(bullet.x);
+            int mapY = static_cast<int>(bullet.y);
+            
+            // Make sure we're in bounds
+            if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) {
+                bullet.active = false;
+                activeBullets--;
+                continue;
+            }
+            
+            // Check for wall collision
+            if (map[mapY * mapWidth + mapX] == '#') {
+                bullet.active = false;
+                activeBullets--;
+                continue;
+            }
+            
+            // Check for collision with enemies near the bullet; the first
+            // enemy in list order wins when several are in reach
+            int hit = -1;
+            enemyIndex.forEachIn(bullet.x - 0.5f, bullet.y - 0.5f, bullet.x + 0.5f, bullet.y + 0.5f, [&](int i) {
+                const Enemy& enemy = enemies[i];
+                float distance = sqrt((bullet.x - enemy.x) * (bullet.x - enemy.x) + 
+                                     (bullet.y - enemy.y) * (bullet.y - enemy.y));
+                if (distance < 0.5f && (hit < 0 || i < hit)) {
+                    hit = i;
+                }
+            });
+            if (hit >= 0) {
+                enemies[hit].alive = false;
+                enemyIndex.version++;
+                bullet.active = false;
+                activeBullets--;
+            }
+        }
+    }
+}
+
+// Function to check if a position is valid and not a wall
+bool isValidPosition(float x, float y) {
+    int mapX = (int)x;
+    int mapY = (int)y;
+    
+    // Check if position is within map bounds
+    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) {
+        return false; // Outside map bounds
+    }
+    
+    // Check if position contains a wall
+    if (map[mapY * mapWidth + mapX] == '#') {
+        return false; // Wall collision
+    }
+    
+    return true; // Valid position
+}
+
+// Function to move the player by an offset if the target is free
+static void tryMove(float dx, float dy) {
+    float newX = playerX + dx;
+    float newY = playerY + dy;
+    
+    // Collision detection with bounds checking
+    if (isValidPosition(newX, newY)) {
+        playerX = newX;
+        playerY = newY;
+    }
+}
+
+// Function to turn the player, keeping the angle within -pi..pi so it never
+// grows without bound
+static void turn(float delta) {
+    const float PI = 3.14159265f;
+    playerA += delta;
+    if (playerA >= PI) playerA -= 2.0f * PI;
+    else if (playerA < -PI) playerA += 2.0f * PI;
+}
+
+// Function to apply one key press (w/a/s/d move, q/e rotate, space shoots)
+void applyKey(char key, float elapsedTime) {
+    switch (key) {
+        case 'w':
+            tryMove(sin(playerA) * playerSpeed * elapsedTime, cos(playerA) * playerSpeed * elapsedTime);
+            break;
+        case 's':
+            tryMove(-sin(playerA) * playerSpeed * elapsedTime, -cos(playerA) * playerSpeed * elapsedTime);
+            break;
+        case 'a':
+            tryMove(-cos(playerA) * playerSpeed * elapsedTime, sin(playerA) * playerSpeed * elapsedTime);
+            break;
+        case 'd':
+            tryMove(cos(playerA) * playerSpeed * elapsedTime, -sin(playerA) * playerSpeed * elapsedTime);
+            break;
+        case 'q': // Left arrow substitute
+            turn(-playerRotSpeed * elapsedTime);
+            break;
+        case 'e': // Right arrow substitute
+            turn(playerRotSpeed * elapsedTime);
+            break;
+        case ' ':
+            shootBullet();
+            break;
+        default:
+            break;
+    }
+}
+
+// Keys an input command can hold, bit i is INPUT_KEYS[i]
+const char INPUT_KEYS[] = "wsadqe ";
+
+// Function to get the command bit of a key, 0 for keys that are not input
+InputCommand inputBit(char key) {
+    for (int i = 0; i < INPUT_KEY_COUNT; i++) {
+        if (INPUT_KEYS[i] == key) return (InputCommand)(1 << i);
+    }
+    return 0;
+}
+
+// Function to apply every key of a command, in INPUT_KEYS order
+void applyInput(InputCommand command, float elapsedTime) {
+    for (int i = 0; i < INPUT_KEY_COUNT; i++) {
+        if (command & (1 << i)) applyKey(INPUT_KEYS[i], elapsedTime);
+    }
+}
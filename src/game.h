@@ -0,0 +1,184 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Screen dimensions
+const int SCREEN_WIDTH = 120;
+const int SCREEN_HEIGHT = 40;
+
+// Player properties
+extern float playerX;
+extern float playerY;
+extern float playerA; // Player angle
+extern float playerFOV; // Field of view
+extern float playerSpeed; // Movement speed
+extern float playerRotSpeed; // Rotation speed
+
+// Map dimensions (the default map is 16x16, generated maps can be larger)
+extern int mapWidth;
+extern int mapHeight;
+
+// Maximum distance a ray travels before it counts as a miss
+extern float maxDepth;
+
+// Game map ('#' = wall, '.' = empty space)
+extern std::string map;
+
+// Bumped whenever the map changes, so cached renders can tell they are stale
+extern unsigned int mapVersion;
+
+// Define trail length as a global constant
+const int BULLET_TRAIL_LENGTH = 5;
+
+// Constant for bullet active message
+extern const std::string BULLET_ACTIVE_MSG;
+
+// Bullets
+struct Bullet {
+    float x, y;
+    float dx, dy;
+    bool active;
+    
+    // Add trail positions to make bullets more visible
+    float trailX[BULLET_TRAIL_LENGTH];
+    float trailY[BULLET_TRAIL_LENGTH];
+    
+    Bullet() : x(0), y(0), dx(0), dy(0), active(false) {
+        // Initialize trail positions
+        for (int i = 0; i < BULLET_TRAIL_LENGTH; i++) {
+            trailX[i] = 0;
+            trailY[i] = 0;
+        }
+    }
+};
+
+extern std::vector<Bullet> bullets;
+const int MAX_BULLETS = 10;
+extern float bulletSpeed;
+
+// Enemies
+struct Enemy {
+    float x, y;
+    bool alive;
+    
+    Enemy(float _x, float _y) : x(_x), y(_y), alive(true) {}
+};
+
+extern std::vector<Enemy> enemies;
+
+// Other players of a network game, drawn like enemies; empty when playing alone
+struct RemotePlayer {
+    float x, y, a;
+};
+
+extern std::vector<RemotePlayer> remotePlayers;
+
+// Map cells per side of one enemy index bucket
+const int ENEMY_BUCKET_SIZE = 4;
+
+// Enemies sorted into square buckets of the map, so lookups near a point
+// only visit the enemies around it. Enemies never move, so the index only
+// needs rebuilding when the list or the map size changes.
+struct EnemyIndex {
+    int columns;
+    int rows;
+    std::vector<int> start;   // First entry of each bucket in items, plus an end marker
+    std::vector<int> items;   // Enemy indices grouped by bucket, ascending within one
+    unsigned int version;     // Bumped when the index is rebuilt or an enemy dies
+    
+    EnemyIndex() : columns(0), rows(0), version(0) {}
+    
+    // Function to find the bucket column or row of a coordinate, clamped to the map
+    static int bucket(float v, int count) {
+        return std::min(count - 1, std::max(0, (int)std::floor(v / ENEMY_BUCKET_SIZE)));
+    }
+    
+    // Function to call visit(i) for every live enemy i in buckets touching a rectangle
+    template <class Visit>
+    void forEachIn(float minX, float minY, float maxX, float maxY, Visit visit) const {
+        if (columns == 0) return;
+        int x0 = bucket(minX, columns);
+        int y0 = bucket(minY, rows);
+        int x1 = bucket(maxX, columns);
+        int y1 = bucket(maxY, rows);
+        
+        // Mostly empty buckets over a large area: checking every enemy is cheaper
+        if ((x1 - x0 + 1) * (y1 - y0 + 1) > (int)items.size()) {
+            for (size_t i = 0; i < items.size(); i++) {
+                const Enemy& enemy = enemies[i];
+                int bx = bucket(enemy.x, columns);
+                int by = bucket(enemy.y, rows);
+                if (enemy.alive && bx >= x0 && bx <= x1 && by >= y0 && by <= y1) visit((int)i);
+            }
+            return;
+        }
+        
+        for (int by = y0; by <= y1; by++) {
+            for (int bx = x0; bx <= x1; bx++) {
+                int b = by * columns + bx;
+                for (int k = start[b]; k < start[b + 1]; k++) {
+                    if (enemies[items[k]].alive) visit(items[k]);
+                }
+            }
+        }
+    }
+};
+
+extern EnemyIndex enemyIndex;
+
+// Function to rebuild the enemy index, call after changing the enemy list or the map size
+void indexEnemies();
+
+// Debug counters
+extern int bulletsFired;
+extern int activeBullets;
+
+// Print shooting/bullet debug messages to the terminal (Unix only)
+extern bool debugOutput;
+
+// Number of debug messages printed so far; they scroll the terminal, so the
+// presenter redraws the whole frame after one
+extern unsigned long debugMessages;
+
+// Function to load the built-in 16x16 map
+void loadDefaultMap();
+
+// Function to generate a bordered map with scattered pillars.
+// The same seed always produces the same map.
+void generateMap(int width, int height, unsigned int seed);
+
+// Function to reset player, bullets and enemies without touching the terminal
+void initWorld();
+
+// Function to initialize the game
+void initGame();
+
+// Function to shoot a bullet
+void shootBullet();
+
+// Function to update bullets
+void updateBullets(float elapsedTime);
+
+// Function to check if a position is valid and not a wall
+bool isValidPosition(float x, float y);
+
+// Function to apply one key press (w/a/s/d move, q/e rotate, space shoots)
+void applyKey(char key, float elapsedTime);
+
+// Keys held during one tick, as sent over the network: one bit per key in
+// the order INPUT_KEYS lists them
+typedef unsigned char InputCommand;
+extern const char INPUT_KEYS[];
+const int INPUT_KEY_COUNT = 7;
+
+// Function to get the command bit of a key, 0 for keys that are not input
+InputCommand inputBit(char key);
+
+// Function to apply every key of a command, in INPUT_KEYS order
+void applyInput(InputCommand command, float elapsedTime);
+
+#endif // GAME_H
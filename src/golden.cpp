@@ -0,0 +1,135 @@
+#include "golden.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Function to check whether a glyph appears near a cell
+static bool glyphNear(const FrameBuffer& fb, int x, int y, int radius, char glyph) {
+    for (int yy = std::max(0, y - radius); yy <= std::min(fb.height - 1, y + radius); yy++) {
+        for (int xx = std::max(0, x - radius); xx <= std::min(fb.width - 1, x + radius); xx++) {
+            if (fb.at(xx, yy) == glyph) return true;
+        }
+    }
+    return false;
+}
+
+// Function to compare a rendered frame against the expected one
+CompareResult compareFrames(const FrameBuffer& expected, const FrameBuffer& actual,
+                            const CompareOptions& options) {
+    CompareResult result = { false, 0, 0 };
+    
+    if (expected.width != actual.width || expected.height != actual.height) {
+        result.mismatches = std::max(expected.width * expected.height, actual.width * actual.height);
+        return result;
+    }
+    
+    for (int y = 0; y < expected.height; y++) {
+        for (int x = 0; x < expected.width; x++) {
+            char want = expected.at(x, y);
+            if (actual.at(x, y) == want) continue;
+            
+            // A glyph that moved by a cell or so still counts in tolerant mode
+            if (options.mode == COMPARE_TOLERANT && glyphNear(actual, x, y, options.neighbourhood, want)) {
+                result.forgiven++;
+            } else {
+                result.mismatches++;
+            }
+        }
+    }
+    
+    if (options.mode == COMPARE_EXACT) {
+        result.match = result.mismatches == 0;
+    } else {
+        int cells = expected.width * expected.height;
+        result.match = result.mismatches <= (int)(options.maxMismatchFraction * cells);
+    }
+    return result;
+}
+
+// Function to describe the differing rows of two frames side by side
+std::string describeFrameDiff(const FrameBuffer& expected, const FrameBuffer& actual, int maxRows) {
+    std::ostringstream out;
+    
+    if (expected.width != actual.width || expected.height != actual.height) {
+        out << "size differs: expected " << expected.width << "x" << expected.height
+            << ", got " << actual.width << "x" << actual.height << "\n";
+        return out.str();
+    }
+    
+    int shown = 0;
+    int differing = 0;
+    for (int y = 0; y < expected.height; y++) {
+        std::string want(expected.row(y), expected.width);
+        std::string got(actual.row(y), actual.width);
+        if (want == got) continue;
+        
+        differing++;
+        if (shown >= maxRows) continue;
+        shown++;
+        
+        std::string marks(expected.width, ' ');
+        for (int x = 0; x < expected.width; x++) {
+            if (want[x] != got[x]) marks[x] = '^';
+        }
+        
+        out << "row " << y << ":\n"
+            << "  expected |" << want << "|\n"
+            << "  actual   |" << got << "|\n"
+            << "           " << " " << marks << "\n";
+    }
+    
+    if (differing > shown) {
+        out << "... " << (differing - shown) << " more differing rows\n";
+    }
+    return out.str();
+}
+
+// Function to write a frame as text
+bool saveFrame(const std::string& path, const FrameBuffer& fb, const std::string& comment) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) return false;
+    
+    out << "# " << comment << "\n";
+    out << fb.width << "x" << fb.height << "\n";
+    for (int y = 0; y < fb.height; y++) {
+        out << '|';
+        out.write(fb.row(y), fb.width);
+        out << "|\n";
+    }
+    return (bool)out;
+}
+
+// Function to read a frame written by saveFrame
+bool loadFrame(const std::string& path, FrameBuffer& fb, std::string& error) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    
+    std::string line;
+    int width = 0, height = 0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        if (std::sscanf(line.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            error = path + ": bad size line";
+            return false;
+        }
+        break;
+    }
+    
+    fb.resize(width, height);
+    for (int y = 0; y < height; y++) {
+        if (!std::getline(in, line) || (int)line.size() != width + 2 || line[0] != '|' || line[width + 1] != '|') {
+            std::ostringstream ss;
+            ss << path << ": bad row " << y;
+            error = ss.str();
+            return false;
+        }
+        std::copy(line.begin() + 1, line.end() - 1, fb.row(y));
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "render.h"
+
+#include <string>
+
+// How strictly two frames have to agree
+enum CompareMode {
+    COMPARE_EXACT,    // Every cell must match
+    COMPARE_TOLERANT  // Allow small shifts and a share of mismatched cells
+};
+
+struct CompareOptions {
+    CompareMode mode;
+    int neighbourhood;          // Tolerant: a cell matches if the expected glyph is this close
+    float maxMismatchFraction;  // Tolerant: share of cells allowed to differ after that
+    
+    CompareOptions() : mode(COMPARE_EXACT), neighbourhood(1), maxMismatchFraction(0.01f) {}
+};
+
+struct CompareResult {
+    bool match;
+    int mismatches;  // Cells that differ and were not forgiven
+    int forgiven;    // Cells that differ but matched within the neighbourhood
+};
+
+// Function to compare a rendered frame against the expected one
+CompareResult compareFrames(const FrameBuffer& expected, const FrameBuffer& actual,
+                            const CompareOptions& options);
+
+// Function to describe the differing rows of two frames side by side,
+// with a marker line under each mismatched cell
+std::string describeFrameDiff(const FrameBuffer& expected, const FrameBuffer& actual, int maxRows);
+
+// Function to write a frame as text, each row wrapped in '|' so trailing
+// spaces survive editors
+bool saveFrame(const std::string& path, const FrameBuffer& fb, const std::string& comment);
+
+// Function to read a frame written by saveFrame
+bool loadFrame(const std::string& path, FrameBuffer& fb, std::string& error);
+
+#endif // GOLDEN_H
@@ -0,0 +1,74 @@
+#include "governor.h"
+#include "game.h"
+
+#include <algorithm>
+
+// columnStep, refineSpan, angularCache, viewDistance, texturedWalls, castFloors, dither, colorDepth, spriteDetail, trailLength
+const RenderQuality QUALITY_LEVELS[QUALITY_LEVEL_COUNT] = {
+    { 1, 0, false, 16.0f, true, true, true, 2, 2, BULLET_TRAIL_LENGTH },
+    { 1, 8, false, 16.0f, true, true, true, 2, 2, 3 },
+    { COLUMN_STEP_ADAPTIVE, 8, true, 12.0f, true, true, true, 1, 1, 2 },
+    { 2, 0, true, 12.0f, true, false, true, 1, 1, 1 },
+    { 2, 0, true, 8.0f, false, false, false, 0, 1, 0 },
+    { 3, 0, true, 8.0f, false, false, false, 0, 0, 0 }
+};
+
+// Step down when the recent average uses this much of the budget
+static const double OVERLOAD_FRACTION = 0.85;
+// Step back up only after this many frames under the low watermark
+static const double CALM_FRACTION = 0.5;
+static const int CALM_FRAMES_TO_RECOVER = 90;
+// Frames to wait after a change before judging the new level
+static const int SETTLE_FRAMES = GOVERNOR_WINDOW;
+
+// Function to switch the renderer to a quality level
+void applyQualityLevel(int level) {
+    level = std::max(0, std::min(level, QUALITY_LEVEL_COUNT - 1));
+    qualityLevel = level;
+    renderQuality = QUALITY_LEVELS[level];
+}
+
+// Function to reset a governor for a frame time budget
+void initGovernor(FrameGovernor& gov, double budgetMs) {
+    gov.budgetMs = budgetMs;
+    gov.samples = 0;
+    gov.next = 0;
+    gov.framesSinceChange = 0;
+    gov.calmFrames = 0;
+    gov.minLevel = 0;
+    gov.maxLevel = QUALITY_LEVEL_COUNT - 1;
+}
+
+// Function to feed one frame time to the governor, returns true when it changed the quality level
+bool updateGovernor(FrameGovernor& gov, double frameMs) {
+    gov.history[gov.next] = frameMs;
+    gov.next = (gov.next + 1) % GOVERNOR_WINDOW;
+    if (gov.samples < GOVERNOR_WINDOW) gov.samples++;
+    gov.framesSinceChange++;
+    
+    if (frameMs < gov.budgetMs * CALM_FRACTION) gov.calmFrames++;
+    else gov.calmFrames = 0;
+    
+    if (gov.framesSinceChange < SETTLE_FRAMES || gov.samples < GOVERNOR_WINDOW) return false;
+    
+    double sum = 0.0;
+    for (int i = 0; i < gov.samples; i++) sum += gov.history[i];
+    double average = sum / gov.samples;
+    
+    int level = qualityLevel;
+    if (average > gov.budgetMs * OVERLOAD_FRACTION && level < gov.maxLevel) {
+        level++;
+    } else if (gov.calmFrames >= CALM_FRAMES_TO_RECOVER && level > gov.minLevel) {
+        level--;
+    } else {
+        return false;
+    }
+    
+    applyQualityLevel(level);
+    gov.framesSinceChange = 0;
+    gov.calmFrames = 0;
+    // Frame times from the old level say nothing about the new one
+    gov.samples = 0;
+    gov.next = 0;
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include "render.h"
+
+// Quality levels from full detail (0) down to the cheapest picture
+const int QUALITY_LEVEL_COUNT = 6;
+extern const RenderQuality QUALITY_LEVELS[QUALITY_LEVEL_COUNT];
+
+// Frames of history the governor averages over
+const int GOVERNOR_WINDOW = 16;
+
+// Watches frame times against the budget and steps the quality level,
+// dropping quickly when frames run long and recovering slowly so the
+// picture does not flicker between levels
+struct FrameGovernor {
+    double budgetMs;
+    double history[GOVERNOR_WINDOW]; // Recent frame times, ring buffer
+    int samples;                     // Valid entries in history
+    int next;                        // Slot the next frame time goes into
+    int framesSinceChange;
+    int calmFrames;                  // Consecutive frames well inside the budget
+    int minLevel;                    // Best level the governor may pick
+    int maxLevel;                    // Cheapest level the governor may pick
+};
+
+// Function to switch the renderer to a quality level
+void applyQualityLevel(int level);
+
+// Function to reset a governor for a frame time budget
+void initGovernor(FrameGovernor& gov, double budgetMs);
+
+// Function to feed one frame time to the governor, returns true when it changed the quality level
+bool updateGovernor(FrameGovernor& gov, double frameMs);
+
+#endif // GOVERNOR_H
@@ -0,0 +1,206 @@
+#include "interest.h"
+
+#include <algorithm>
+
+// Function to check that no wall stands on the straight line between two
+// points, walking the cells it crosses
+static bool clearLine(float x0, float y0, float x1, float y1) {
+    int cx = (int)x0, cy = (int)y0;
+    int ex = (int)x1, ey = (int)y1;
+    float dx = x1 - x0, dy = y1 - y0;
+    int stepX = dx > 0 ? 1 : -1;
+    int stepY = dy > 0 ? 1 : -1;
+    const float FAR = 1e30f;
+    float deltaX = dx != 0 ? std::fabs(1.0f / dx) : FAR;
+    float deltaY = dy != 0 ? std::fabs(1.0f / dy) : FAR;
+    float nextX = dx != 0 ? (dx > 0 ? cx + 1 - x0 : x0 - cx) * deltaX : FAR;
+    float nextY = dy != 0 ? (dy > 0 ? cy + 1 - y0 : y0 - cy) * deltaY : FAR;
+    
+    for (int steps = std::abs(ex - cx) + std::abs(ey - cy); steps > 0; steps--) {
+        if (nextX < nextY) {
+            nextX += deltaX;
+            cx += stepX;
+        } else {
+            nextY += deltaY;
+            cy += stepY;
+        }
+        if (map[cy * mapWidth + cx] == '#') return false;
+    }
+    return true;
+}
+
+// Function to check whether anything in one cell can see anything in
+// another: the centres, or the matching corners of the two, in sight
+static bool cellsSee(int ax, int ay, int bx, int by) {
+    static const float POINTS[][2] = { { 0.5f, 0.5f }, { 0.1f, 0.1f }, { 0.9f, 0.1f }, { 0.1f, 0.9f }, { 0.9f, 0.9f } };
+    for (size_t i = 0; i < sizeof(POINTS) / sizeof(POINTS[0]); i++) {
+        if (clearLine(ax + POINTS[i][0], ay + POINTS[i][1], bx + POINTS[i][0], by + POINTS[i][1])) return true;
+    }
+    return false;
+}
+
+// Function to find the visibility bit of the cell dx, dy away from a cell
+static inline size_t visibilityBit(const InterestGrid& grid, int cell, int dx, int dy) {
+    int side = 2 * grid.radius + 1;
+    return (size_t)cell * side * side + (dy + grid.radius) * side + (dx + grid.radius);
+}
+
+// Function to work out which cells see which, for every pair of open cells
+// within radius of each other; each pair is walked once
+static void buildVisibility(InterestGrid& grid) {
+    grid.width = mapWidth;
+    grid.height = mapHeight;
+    grid.radius = (int)std::ceil(maxDepth);
+    grid.mapVersion = mapVersion;
+    int side = 2 * grid.radius + 1;
+    grid.visible.assign(((size_t)mapWidth * mapHeight * side * side + 7) / 8, 0);
+    
+    for (int ay = 0; ay < mapHeight; ay++) {
+        for (int ax = 0; ax < mapWidth; ax++) {
+            if (map[ay * mapWidth + ax] == '#') continue;
+            for (int by = ay; by <= std::min(mapHeight - 1, ay + grid.radius); by++) {
+                for (int bx = std::max(0, ax - grid.radius); bx <= std::min(mapWidth - 1, ax + grid.radius); bx++) {
+                    if ((by == ay && bx < ax) || (bx - ax) * (bx - ax) + (by - ay) * (by - ay) > grid.radius * grid.radius) continue;
+                    if (map[by * mapWidth + bx] == '#' || !cellsSee(ax, ay, bx, by)) continue;
+                    size_t there = visibilityBit(grid, ay * mapWidth + ax, bx - ax, by - ay);
+                    size_t back = visibilityBit(grid, by * mapWidth + bx, ax - bx, ay - by);
+                    grid.visible[there / 8] |= (unsigned char)(1 << (there % 8));
+                    grid.visible[back / 8] |= (unsigned char)(1 << (back % 8));
+                }
+            }
+        }
+    }
+}
+
+// Function to find the cell column or row of a quantized coordinate, clamped to the map
+static inline int cellAt(unsigned short q, int count) {
+    return std::min(count - 1, (int)(q / POSITION_SCALE));
+}
+
+// Function to find the cell of every entity of this tick's world
+void indexInterest(InterestGrid& grid, const Snapshot& world) {
+    if (grid.mapVersion != mapVersion || grid.radius != (int)std::ceil(maxDepth)) buildVisibility(grid);
+    grid.world = &world;
+    grid.cellX.resize(world.entities.size());
+    grid.cellY.resize(world.entities.size());
+    for (size_t i = 0; i < world.entities.size(); i++) {
+        grid.cellX[i] = (short)cellAt(world.entities[i].x, grid.width);
+        grid.cellY[i] = (short)cellAt(world.entities[i].y, grid.height);
+    }
+}
+
+// Function to order candidates most overdue first, by ID among equals
+static bool moreOverdue(const InterestCandidate& a, const InterestCandidate& b) {
+    return a.rank != b.rank ? a.rank > b.rank : a.entity < b.entity;
+}
+
+// Function to tell view entries that were held for an entity the cap kept out
+static bool isDropped(const EntityState& e) {
+    return e.id == 0;
+}
+
+// Function to choose what one client is shown this tick
+const Snapshot& chooseView(InterestGrid& grid, ClientInterest& client, unsigned int viewerId, unsigned int tick,
+                           unsigned int ackedTick, int budget, InterestCounts& counts) {
+    // Claim the slot first, so a baseline it held is no longer found
+    Snapshot& view = client.views.slotFor(tick);
+    view.tick = tick;
+    view.entities.clear();
+    const Snapshot& world = *grid.world;
+    const EntityState* viewer = findEntity(world, viewerId);
+    if (!viewer) return view;
+    
+    // A view never holds more than the world, so it grows with it rather
+    // than every time it takes in more of it
+    if (view.entities.capacity() < world.entities.capacity()) view.entities.reserve(world.entities.capacity());
+    
+    static const std::vector<EntityState> none;
+    const Snapshot* shownView = client.views.find(tick - 1);
+    const Snapshot* ackedView = client.views.find(ackedTick);
+    const std::vector<EntityState>& shown = shownView ? shownView->entities : none;
+    const std::vector<EntityState>& acked = ackedView ? ackedView->entities : none;
+    std::vector<float>& priority = client.priority;
+    if (priority.size() <= world.entities.back().id) priority.resize(world.entities.back().id + 1, 0.0f);
+    
+    float vx = dequantizePosition(viewer->x);
+    float vy = dequantizePosition(viewer->y);
+    int fromX = cellAt(viewer->x, grid.width), fromY = cellAt(viewer->y, grid.height);
+    int from = fromY * grid.width + fromX;
+    const float NEAR2 = INTEREST_NEAR_CELLS * INTEREST_NEAR_CELLS;
+    const float PROXIMITY2 = INTEREST_PROXIMITY_CELLS * INTEREST_PROXIMITY_CELLS;
+    const float DEPTH2 = maxDepth * maxDepth;
+    
+    // Walk the world in ID order, alongside what the client was shown last
+    // tick and what it acknowledged. Every relevant entity is sent, left as
+    // the client saw it, or held a place in the view while it waits for the cap.
+    std::vector<InterestCandidate>& due = grid.candidates;
+    due.clear();
+    int spent = 0, dueCost = 0;
+    unsigned long relevant = 0;
+    size_t s = 0, a = 0;
+    for (size_t i = 0; i < world.entities.size(); i++) {
+        const EntityState& e = world.entities[i];
+        bool own = e.id == viewerId;
+        float d2 = 0.0f;
+        if (!own) {
+            int cx = grid.cellX[i] - fromX, cy = grid.cellY[i] - fromY;
+            if (std::abs(cx) > grid.radius || std::abs(cy) > grid.radius) continue;
+            float dx = dequantizePosition(e.x) - vx;
+            float dy = dequantizePosition(e.y) - vy;
+            d2 = dx * dx + dy * dy;
+            if (d2 > DEPTH2) continue;
+            size_t bit = visibilityBit(grid, from, cx, cy);
+            if (d2 > PROXIMITY2 && !((grid.visible[bit / 8] >> (bit % 8)) & 1)) continue;
+        }
+        relevant++;
+        
+        while (s < shown.size() && shown[s].id < e.id) s++;
+        while (a < acked.size() && acked[a].id < e.id) a++;
+        const EntityState* before = s < shown.size() && shown[s].id == e.id ? &shown[s] : NULL;
+        const EntityState* base = a < acked.size() && acked[a].id == e.id ? &acked[a] : NULL;
+        float& p = priority[e.id];
+        p += d2 <= NEAR2 ? 1.0f : std::max(INTEREST_MIN_RATE, NEAR2 / d2);
+        if (own) {
+            view.entities.push_back(e);
+            spent += entityDeltaBytes(base, e);
+            p = 0.0f;
+            counts.sent++;
+        } else if (before && p < 1.0f) {
+            view.entities.push_back(*before);
+            spent += entityDeltaBytes(base, *before);
+            counts.held++;
+        } else {
+            InterestCandidate c = { (int)view.entities.size(), (int)i, before ? p : p + 1.0f, entityDeltaBytes(base, e), before };
+            due.push_back(c);
+            dueCost += c.cost;
+            view.entities.push_back(before ? *before : e);
+        }
+    }
+    
+    // Due entities all go when they fit under the cap; otherwise the most
+    // overdue first, and the rest stay as the client saw them, or out of its
+    // view if it never did
+    if (spent + dueCost > budget) std::sort(due.begin(), due.end(), moreOverdue);
+    bool dropped = false;
+    for (size_t i = 0; i < due.size(); i++) {
+        const InterestCandidate& c = due[i];
+        const EntityState& e = world.entities[c.entity];
+        if (spent + c.cost <= budget) {
+            view.entities[c.slot] = e;
+            spent += c.cost;
+            priority[e.id] = 0.0f;
+            counts.sent++;
+            continue;
+        }
+        counts.capped++;
+        if (!c.shown) {
+            view.entities[c.slot].id = 0;
+            dropped = true;
+        }
+    }
+    if (dropped) view.entities.erase(std::remove_if(view.entities.begin(), view.entities.end(), isDropped), view.entities.end());
+    
+    counts.relevant += relevant;
+    counts.culled += world.entities.size() - relevant;
+    return view;
+}
@@ -0,0 +1,86 @@
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include "snapshot.h"
+
+#include <vector>
+
+// Entities a player can see within this many cells are sent every tick
+const float INTEREST_NEAR_CELLS = 6.0f;
+
+// Farther ones, out to maxDepth, are sent less often as the square of the
+// distance grows, but at least this often
+const float INTEREST_MIN_RATE = 0.125f;
+
+// Entities this close are sent even behind a wall, so nobody pops into
+// view round a corner
+const float INTEREST_PROXIMITY_CELLS = 1.5f;
+
+// Snapshot body bytes one client is sent per tick at most, as estimated
+// before encoding. The own player, removals and entities left at an older
+// state go regardless; the cap decides which due updates wait a tick.
+const int SNAPSHOT_BUDGET_BYTES = 600;
+
+// What interest management did for one client, or summed over many
+struct InterestCounts {
+    unsigned long relevant; // Entities the client may be sent
+    unsigned long sent;     // Of those, sent with this tick's state
+    unsigned long held;     // Left at the state sent before, not due yet
+    unsigned long capped;   // Due, but over the bandwidth cap
+    unsigned long culled;   // In the world but not relevant to the client
+    
+    InterestCounts() : relevant(0), sent(0), held(0), capped(0), culled(0) {}
+    
+    void add(const InterestCounts& o) {
+        relevant += o.relevant;
+        sent += o.sent;
+        held += o.held;
+        capped += o.capped;
+        culled += o.culled;
+    }
+};
+
+// What one client has been sent: the world as it was shown to it each tick,
+// which later snapshots delta against, and how overdue each entity is
+struct ClientInterest {
+    SnapshotHistory views;
+    std::vector<float> priority; // By entity ID; grows by the entity's rate every relevant tick, 0 once sent
+};
+
+// An entity due to be sent this tick, waiting for its share of the cap
+struct InterestCandidate {
+    int slot;                 // Its place in the view
+    int entity;               // Index into the world snapshot
+    float rank;               // Priority, plus one for entities new to the client
+    int cost;                 // Estimated bytes
+    const EntityState* shown; // State the client was last sent, NULL when new
+};
+
+// The map cells and what is in them: which cells can see each other, built
+// once per map, and the cell of each of the world's entities, every tick
+struct InterestGrid {
+    int width, height;
+    int radius;                         // Cells of maxDepth, the farthest a cell's visibility reaches
+    unsigned int mapVersion;            // Map the visibility was built for, 0 before the first
+    std::vector<unsigned char> visible; // Per cell, a bit for each cell within radius
+    const Snapshot* world;              // This tick's world
+    std::vector<short> cellX, cellY;    // Cell of each of its entities
+    std::vector<InterestCandidate> candidates; // Scratch for one client
+    
+    InterestGrid() : width(0), height(0), radius(0), mapVersion(0), world(NULL) {}
+};
+
+// Function to find the cell of every entity of this tick's world, first
+// rebuilding which cells see which when the map changed
+void indexInterest(InterestGrid& grid, const Snapshot& world);
+
+// Function to choose what one client is shown this tick and record it in
+// its views. Entities out of range or out of sight are left out; the others
+// earn priority at their rate and are sent once it reaches 1 (or at once
+// when new to the client), most overdue first while the cap lasts, and are
+// otherwise left as the client last saw them. The player's own entity is
+// always sent. Returns the view.
+const Snapshot& chooseView(InterestGrid& grid, ClientInterest& client, unsigned int viewerId, unsigned int tick,
+                           unsigned int ackedTick, int budget, InterestCounts& counts);
+
+#endif // INTEREST_H
@@ -0,0 +1,214 @@
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Records waiting for the writer thread; the frame thread is the only
+// producer and the writer the only consumer
+static const size_t RING_SIZE = 1024;
+static FrameStats ring[RING_SIZE];
+static std::atomic<size_t> ringHead(0); // Next slot the frame thread writes
+static std::atomic<size_t> ringTail(0); // Next slot the writer reads
+static std::atomic<long> lostRecords(0);
+
+static std::atomic<bool> writerRunning(false);
+static std::thread writerThread;
+static FILE* metricsFile = NULL;
+static int metricsEvery = 1;
+static double metricsEpochMs = 0.0;
+
+// Sums over the frames of one output record
+struct MetricsAccumulator {
+    int frames;
+    long lastFrame;
+    double startMs;
+    double frameMsSum;
+    double frameMsMax;
+    double stageMs[STAGE_COUNT];
+    unsigned long long stagePerf[STAGE_COUNT][PERF_COUNTER_COUNT];
+    size_t bytesWritten;
+    int syscalls;
+    int dropped;
+    unsigned long allocations;
+    unsigned long allocBytes;
+    int enemiesAlive;
+    int bulletsActive;
+    int quality;
+    bool networked;
+    int corrections;
+    float predictionErrorMax;
+};
+
+static void resetAccumulator(MetricsAccumulator& acc) {
+    acc.frames = 0;
+    acc.lastFrame = 0;
+    acc.startMs = 0.0;
+    acc.frameMsSum = 0.0;
+    acc.frameMsMax = 0.0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        acc.stageMs[i] = 0.0;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) acc.stagePerf[i][c] = 0;
+    }
+    acc.bytesWritten = 0;
+    acc.syscalls = 0;
+    acc.dropped = 0;
+    acc.allocations = 0;
+    acc.allocBytes = 0;
+    acc.networked = false;
+    acc.corrections = 0;
+    acc.predictionErrorMax = 0.0f;
+}
+
+static void accumulate(MetricsAccumulator& acc, const FrameStats& stats) {
+    if (acc.frames == 0) acc.startMs = stats.startMs;
+    acc.frames++;
+    acc.lastFrame = stats.frame;
+    acc.frameMsSum += stats.frameMs;
+    if (stats.frameMs > acc.frameMsMax) acc.frameMsMax = stats.frameMs;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        acc.stageMs[i] += stats.stageMs[i];
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) acc.stagePerf[i][c] += stats.stagePerf[i][c];
+    }
+    acc.bytesWritten += stats.bytesWritten;
+    acc.syscalls += stats.syscalls;
+    if (stats.dropped) acc.dropped++;
+    acc.allocations += stats.allocations;
+    acc.allocBytes += stats.allocBytes;
+    acc.enemiesAlive = stats.enemiesAlive;
+    acc.bulletsActive = stats.bulletsActive;
+    acc.quality = stats.quality;
+    if (stats.networked) acc.networked = true;
+    acc.corrections += stats.corrections;
+    acc.predictionErrorMax = std::max(acc.predictionErrorMax, stats.predictionError);
+}
+
+// Function to write one JSON line; stage times are per-frame means
+static void writeRecord(const MetricsAccumulator& acc) {
+    double n = acc.frames;
+    std::fprintf(metricsFile,
+                 "{\"frame\":%ld,\"frames\":%d,\"t_ms\":%.3f,\"frame_ms\":%.4f,\"frame_ms_max\":%.4f,\"stage_ms\":{",
+                 acc.lastFrame, acc.frames, acc.startMs - metricsEpochMs, acc.frameMsSum / n, acc.frameMsMax);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        std::fprintf(metricsFile, "%s\"%s\":%.4f", i ? "," : "", stageName((Stage)i), acc.stageMs[i] / n);
+    }
+    std::fprintf(metricsFile, "}");
+    
+    // Hardware counters per stage: [cycles, instructions, cache misses, branch misses]
+    if (perfCountersEnabled) {
+        std::fprintf(metricsFile, ",\"perf\":{");
+        bool first = true;
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            if (acc.stagePerf[i][PERF_CYCLES] == 0) continue;
+            std::fprintf(metricsFile, "%s\"%s\":[%llu,%llu,%llu,%llu]", first ? "" : ",", stageName((Stage)i),
+                         acc.stagePerf[i][PERF_CYCLES], acc.stagePerf[i][PERF_INSTRUCTIONS],
+                         acc.stagePerf[i][PERF_CACHE_MISSES], acc.stagePerf[i][PERF_BRANCH_MISSES]);
+            first = false;
+        }
+        std::fprintf(metricsFile, "}");
+    }
+    
+    // Client prediction in a network game: corrections and the worst error, in cells
+    if (acc.networked) {
+        std::fprintf(metricsFile, ",\"corrections\":%d,\"prediction_error\":%.4f", acc.corrections, acc.predictionErrorMax);
+    }
+    
+    std::fprintf(metricsFile,
+                 ",\"bytes\":%lu,\"syscalls\":%d,\"allocs\":%lu,\"alloc_bytes\":%lu,"
+                 "\"enemies\":%d,\"bullets\":%d,\"quality\":%d,\"dropped\":%d,\"lost_records\":%ld}\n",
+                 (unsigned long)acc.bytesWritten, acc.syscalls, acc.allocations, acc.allocBytes,
+                 acc.enemiesAlive, acc.bulletsActive, acc.quality, acc.dropped, lostRecords.load(std::memory_order_relaxed));
+}
+
+// Function to move every queued record into the output, returns how many
+static size_t drainRing(MetricsAccumulator& acc) {
+    size_t tail = ringTail.load(std::memory_order_relaxed);
+    size_t head = ringHead.load(std::memory_order_acquire);
+    size_t drained = head - tail;
+    while (tail != head) {
+        accumulate(acc, ring[tail % RING_SIZE]);
+        tail++;
+        if (acc.frames >= metricsEvery) {
+            writeRecord(acc);
+            resetAccumulator(acc);
+        }
+    }
+    ringTail.store(tail, std::memory_order_release);
+    return drained;
+}
+
+static void writerLoop() {
+    traceThreadName("metrics writer");
+    MetricsAccumulator acc;
+    resetAccumulator(acc);
+    
+    while (writerRunning.load(std::memory_order_acquire)) {
+        size_t drained;
+        {
+            TraceScope scope("metrics.write");
+            drained = drainRing(acc);
+            std::fflush(metricsFile);
+        }
+        
+        // Poll faster when frames come in quicker than real time (headless runs)
+        std::this_thread::sleep_for(std::chrono::milliseconds(drained > RING_SIZE / 4 ? 1 : 20));
+    }
+    
+    // Final records, including a partial group
+    drainRing(acc);
+    if (acc.frames > 0) writeRecord(acc);
+    std::fflush(metricsFile);
+}
+
+// Function to start writing metrics to a file
+bool openMetrics(const std::string& path, int everyNFrames) {
+    if (metricsFile) closeMetrics();
+    
+    metricsFile = std::fopen(path.c_str(), "w");
+    if (!metricsFile) return false;
+    
+    // Large stdio buffer so the writer thread rarely hits the disk
+    std::setvbuf(metricsFile, NULL, _IOFBF, 1 << 16);
+    metricsEvery = everyNFrames > 0 ? everyNFrames : 1;
+    metricsEpochMs = nowMs();
+    ringHead.store(0);
+    ringTail.store(0);
+    lostRecords.store(0);
+    
+    writerRunning.store(true, std::memory_order_release);
+    writerThread = std::thread(writerLoop);
+    return true;
+}
+
+// Function to hand a finished frame to the metrics writer
+void recordFrameMetrics(const FrameStats& stats) {
+    if (!metricsFile) return;
+    
+    size_t head = ringHead.load(std::memory_order_relaxed);
+    if (head - ringTail.load(std::memory_order_acquire) >= RING_SIZE) {
+        // Writer fell behind, drop the record rather than wait
+        lostRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring[head % RING_SIZE] = stats;
+    ringHead.store(head + 1, std::memory_order_release);
+}
+
+// Function to flush outstanding records and stop the writer
+void closeMetrics() {
+    if (!metricsFile) return;
+    
+    writerRunning.store(false, std::memory_order_release);
+    if (writerThread.joinable()) writerThread.join();
+    std::fclose(metricsFile);
+    metricsFile = NULL;
+}
+
+// Function to check whether a metrics sink is open
+bool metricsEnabled() {
+    return metricsFile != NULL;
+}
@@ -0,0 +1,27 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "profile.h"
+
+#include <string>
+
+// Optional JSON-lines metrics sink for long runs.
+//
+// The frame thread only copies its FrameStats into a fixed-size ring; a
+// background thread formats the records and writes them out, so logging
+// never costs the frame it measures more than a copy.
+
+// Function to start writing metrics to a file, one record every N frames.
+// Returns false if the file cannot be opened.
+bool openMetrics(const std::string& path, int everyNFrames);
+
+// Function to hand a finished frame to the metrics writer
+void recordFrameMetrics(const FrameStats& stats);
+
+// Function to flush outstanding records and stop the writer
+void closeMetrics();
+
+// Function to check whether a metrics sink is open
+bool metricsEnabled();
+
+#endif // METRICS_H
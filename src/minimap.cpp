@@ -0,0 +1,214 @@
+#include "minimap.h"
+#include "game.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+int miniMapZoom = 0;
+
+// Glyphs for the share of walls under a zoomed-out glyph: none, up to a
+// third, up to two thirds, less than all, all
+static const char COVERAGE_RAMP[] = ".:o%#";
+
+// The map at one zoom level, pre-rendered
+struct MiniMapLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> coverage; // Share of wall cells, 0 to 255
+    std::vector<char> glyphs;
+};
+
+// Every zoom level of the current map, rebuilt when the map changes
+static std::vector<MiniMapLevel> levels;
+static unsigned int levelsMapVersion = 0;
+static bool levelsValid = false;
+
+// Function to get the glyph of a zoomed-out cell from its wall coverage
+static char coverageGlyph(int coverage) {
+    if (coverage == 0) return COVERAGE_RAMP[0];
+    if (coverage == 255) return COVERAGE_RAMP[4];
+    if (coverage * 3 <= 255) return COVERAGE_RAMP[1];
+    if (coverage * 3 <= 510) return COVERAGE_RAMP[2];
+    return COVERAGE_RAMP[3];
+}
+
+// Function to count the zoom levels of a map: halve it until it fits
+static int levelCount(int width, int height) {
+    int count = 1;
+    while (width > MINIMAP_SIZE || height > MINIMAP_SIZE) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        count++;
+    }
+    return count;
+}
+
+// Function to build every zoom level from the map. Level 0 is the map
+// itself; each level above averages 2x2 cells of the one below.
+static void buildLevels() {
+    levels.resize(levelCount(mapWidth, mapHeight));
+    
+    MiniMapLevel& base = levels[0];
+    base.width = mapWidth;
+    base.height = mapHeight;
+    base.glyphs.assign(map.begin(), map.end());
+    base.coverage.resize(map.size());
+    for (size_t i = 0; i < map.size(); i++) {
+        base.coverage[i] = map[i] == '#' ? 255 : 0;
+    }
+    
+    for (size_t l = 1; l < levels.size(); l++) {
+        const MiniMapLevel& below = levels[l - 1];
+        MiniMapLevel& level = levels[l];
+        level.width = (below.width + 1) / 2;
+        level.height = (below.height + 1) / 2;
+        level.coverage.resize(level.width * level.height);
+        level.glyphs.resize(level.width * level.height);
+        
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                // Odd sizes leave the last row or column with fewer cells below
+                int sum = 0;
+                int cells = 0;
+                for (int dy = 0; dy < 2 && y * 2 + dy < below.height; dy++) {
+                    for (int dx = 0; dx < 2 && x * 2 + dx < below.width; dx++) {
+                        sum += below.coverage[(y * 2 + dy) * below.width + x * 2 + dx];
+                        cells++;
+                    }
+                }
+                int coverage = (sum + cells / 2) / cells;
+                level.coverage[y * level.width + x] = (unsigned char)coverage;
+                level.glyphs[y * level.width + x] = coverageGlyph(coverage);
+            }
+        }
+    }
+    
+    levelsMapVersion = mapVersion;
+    levelsValid = true;
+}
+
+// Function to get the zoom level actually shown
+static int shownZoom() {
+    return std::max(0, std::min(miniMapZoom, levelCount(mapWidth, mapHeight) - 1));
+}
+
+// Where the mini-map goes on a framebuffer
+struct MiniMapWindow {
+    bool shown;     // There is room for it
+    int viewWidth;  // Glyphs of the zoom level shown across and down
+    int viewHeight;
+    int mapStartX;  // Column of its first glyph, right of the border
+};
+
+// Function to place the mini-map of a zoom level in the top right corner
+static MiniMapWindow miniMapWindow(const FrameBuffer& fb, int zoom) {
+    int width = mapWidth;
+    int height = mapHeight;
+    for (int z = 0; z < zoom; z++) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    MiniMapWindow window;
+    window.viewWidth = std::min(width, MINIMAP_SIZE);
+    window.viewHeight = std::min(height, MINIMAP_SIZE);
+    window.mapStartX = fb.width - window.viewWidth - 3;
+    
+    // Only draw mini-map if there's enough space
+    window.shown = window.mapStartX > fb.width / 2 && window.viewHeight + 2 < fb.height;
+    return window;
+}
+
+// Function to find the first column the mini-map covers
+int miniMapLeft(const FrameBuffer& fb) {
+    MiniMapWindow window = miniMapWindow(fb, shownZoom());
+    return window.shown ? window.mapStartX - 1 : fb.width;
+}
+
+// Function to get the state the mini-map would be drawn from now
+MiniMapState miniMapState(const FrameBuffer& fb) {
+    MiniMapState state;
+    state.mapVersion = mapVersion;
+    state.enemyVersion = enemyIndex.version;
+    state.zoom = shownZoom();
+    state.playerX = (int)std::floor(playerX / (1 << state.zoom));
+    state.playerY = (int)std::floor(playerY / (1 << state.zoom));
+    state.width = fb.width;
+    state.height = fb.height;
+    return state;
+}
+
+// Function to check whether two states draw the same mini-map
+bool sameMiniMapState(const MiniMapState& a, const MiniMapState& b) {
+    return a.mapVersion == b.mapVersion && a.enemyVersion == b.enemyVersion && a.zoom == b.zoom &&
+           a.playerX == b.playerX && a.playerY == b.playerY && a.width == b.width && a.height == b.height;
+}
+
+// Function to count the zoom levels of the current map
+int miniMapZoomLevels() {
+    return levelCount(mapWidth, mapHeight);
+}
+
+// Function to step to the next zoom level
+void cycleMiniMapZoom() {
+    miniMapZoom = (miniMapZoom + 1) % miniMapZoomLevels();
+}
+
+// Function to draw the mini-map in the top right corner
+void drawMiniMap(FrameBuffer& fb) {
+    if (!levelsValid || levelsMapVersion != mapVersion) {
+        buildLevels();
+    }
+    
+    int zoom = shownZoom();
+    const MiniMapLevel& level = levels[zoom];
+    int scale = 1 << zoom;
+    MiniMapWindow window = miniMapWindow(fb, zoom);
+    if (!window.shown) return;
+    int viewWidth = window.viewWidth;
+    int viewHeight = window.viewHeight;
+    int mapStartX = window.mapStartX;
+    
+    // Scroll so the player stays in the middle, stopping at the map edges
+    float viewX = playerX / scale;
+    float viewY = playerY / scale;
+    int originX = std::max(0, std::min(level.width - viewWidth, (int)std::floor(viewX) - viewWidth / 2));
+    int originY = std::max(0, std::min(level.height - viewHeight, (int)std::floor(viewY) - viewHeight / 2));
+    
+    // Border around the visible part of the pre-rendered level
+    std::memset(&fb.at(mapStartX - 1, 0), '+', viewWidth + 2);
+    std::memset(&fb.at(mapStartX - 1, viewHeight + 1), '+', viewWidth + 2);
+    for (int y = 0; y < viewHeight; y++) {
+        char* row = &fb.at(mapStartX - 1, y + 1);
+        row[0] = '+';
+        std::memcpy(row + 1, &level.glyphs[(originY + y) * level.width + originX], viewWidth);
+        row[viewWidth + 1] = '+';
+    }
+    
+    // Live enemies in the window, from the enemy index
+    enemyIndex.forEachIn((float)(originX * scale), (float)(originY * scale),
+                         (float)((originX + viewWidth) * scale), (float)((originY + viewHeight) * scale), [&](int i) {
+        int x = (int)std::floor(enemies[i].x / scale) - originX;
+        int y = (int)std::floor(enemies[i].y / scale) - originY;
+        if (x >= 0 && x < viewWidth && y >= 0 && y < viewHeight) {
+            fb.at(mapStartX + x, y + 1) = 'E';
+        }
+    });
+    
+    // Draw player on mini-map
+    int playerMapX = (int)std::floor(viewX) - originX;
+    int playerMapY = (int)std::floor(viewY) - originY;
+    if (playerMapX >= 0 && playerMapX < viewWidth && playerMapY >= 0 && playerMapY < viewHeight) {
+        fb.at(mapStartX + playerMapX, playerMapY + 1) = 'P';
+    }
+    
+    // Add a label for the mini-map, with the scale when zoomed out
+    char label[16];
+    int length = zoom > 0 ? std::snprintf(label, sizeof(label), "MAP 1:%d", scale)
+                          : std::snprintf(label, sizeof(label), "MAP");
+    for (int i = 0; i < length && mapStartX + i < fb.width; i++) {
+        fb.at(mapStartX + i, 0) = label[i];
+    }
+}
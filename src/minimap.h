@@ -0,0 +1,44 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "render.h"
+
+// Most map glyphs the mini-map shows across and down
+const int MINIMAP_SIZE = 16;
+
+// Zoom level of the mini-map: each glyph covers 2^zoom by 2^zoom map cells.
+// Levels above the one that fits the whole map are shown as that level.
+extern int miniMapZoom;
+
+// Everything the mini-map's cells depend on
+struct MiniMapState {
+    unsigned int mapVersion;
+    unsigned int enemyVersion;
+    int zoom;
+    int playerX, playerY; // Glyph the player is on at that zoom
+    int width, height;    // Framebuffer size
+};
+
+// Function to get the state the mini-map would be drawn from now
+MiniMapState miniMapState(const FrameBuffer& fb);
+
+// Function to check whether two states draw the same mini-map
+bool sameMiniMapState(const MiniMapState& a, const MiniMapState& b);
+
+// Function to count the zoom levels of the current map; the last one shows
+// all of it
+int miniMapZoomLevels();
+
+// Function to step to the next zoom level, wrapping back to 0 after the
+// level that shows the whole map
+void cycleMiniMapZoom();
+
+// Function to find the first column the mini-map's border covers, or the
+// framebuffer width when there is no room for the mini-map
+int miniMapLeft(const FrameBuffer& fb);
+
+// Function to draw the mini-map in the top right corner, scrolled so the
+// player stays in view
+void drawMiniMap(FrameBuffer& fb);
+
+#endif // MINIMAP_H
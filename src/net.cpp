@@ -0,0 +1,145 @@
+#include "net.h"
+#include "platform.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef PLATFORM_UNIX
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// Function to parse "host:port" (IPv4 dotted or "localhost"), returns false on bad input
+bool parseAddress(const std::string& text, NetAddress& address) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) return false;
+    std::string host = text.substr(0, colon);
+    int port = std::atoi(text.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) return false;
+    if (host.empty() || host == "localhost") host = "127.0.0.1";
+    
+    unsigned int parts[4];
+    char tail;
+    if (std::sscanf(host.c_str(), "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &tail) != 4) return false;
+    unsigned int ip = 0;
+    for (int i = 0; i < 4; i++) {
+        if (parts[i] > 255) return false;
+        ip = (ip << 8) | parts[i];
+    }
+    address = NetAddress(ip, (unsigned short)port);
+    return true;
+}
+
+// Function to format an address as "a.b.c.d:port"
+std::string formatAddress(const NetAddress& address) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", address.host >> 24, (address.host >> 16) & 255,
+                  (address.host >> 8) & 255, address.host & 255, address.port);
+    return text;
+}
+
+#ifdef PLATFORM_UNIX
+
+// Function to open a UDP socket bound to a port on every interface
+bool openUdp(UdpSocket& sock, unsigned short port, std::string& error) {
+    sock = UdpSocket();
+    sock.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock.fd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock.fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        error = std::string("bind: ") + std::strerror(errno);
+        closeUdp(sock);
+        return false;
+    }
+    
+    // Many clients' snapshots can queue up between two reads
+    int buffer = 1 << 20;
+    setsockopt(sock.fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    setsockopt(sock.fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    
+    int flags = fcntl(sock.fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(sock.fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        error = std::string("fcntl: ") + std::strerror(errno);
+        closeUdp(sock);
+        return false;
+    }
+    return true;
+}
+
+// Function to close a socket
+void closeUdp(UdpSocket& sock) {
+    if (sock.fd >= 0) close(sock.fd);
+    sock.fd = -1;
+}
+
+// Function to get the port a socket is bound to
+unsigned short boundPort(const UdpSocket& sock) {
+    sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    if (getsockname(sock.fd, (sockaddr*)&addr, &length) < 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+// Function to send one datagram, returns false if it could not be queued
+bool sendPacket(UdpSocket& sock, const NetAddress& to, const unsigned char* data, int size) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(to.host);
+    addr.sin_port = htons(to.port);
+    ssize_t sent = sendto(sock.fd, data, size, 0, (sockaddr*)&addr, sizeof(addr));
+    if (sent != size) return false;
+    sock.bytesSent += size;
+    sock.packetsSent++;
+    return true;
+}
+
+// Function to receive one waiting datagram, returns its size or -1 when nothing is waiting
+int receivePacket(UdpSocket& sock, NetAddress& from, unsigned char* data, int capacity) {
+    sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    ssize_t size = recvfrom(sock.fd, data, capacity, 0, (sockaddr*)&addr, &length);
+    if (size < 0) return -1;
+    from = NetAddress(ntohl(addr.sin_addr.s_addr), ntohs(addr.sin_port));
+    sock.bytesReceived += size;
+    sock.packetsReceived++;
+    return (int)size;
+}
+
+#else
+
+// Multiplayer needs BSD sockets; the Windows build plays single-player only
+bool openUdp(UdpSocket& sock, unsigned short, std::string& error) {
+    sock = UdpSocket();
+    error = "networking is only available on Linux/Unix";
+    return false;
+}
+
+void closeUdp(UdpSocket& sock) {
+    sock.fd = -1;
+}
+
+unsigned short boundPort(const UdpSocket&) {
+    return 0;
+}
+
+bool sendPacket(UdpSocket&, const NetAddress&, const unsigned char*, int) {
+    return false;
+}
+
+int receivePacket(UdpSocket&, NetAddress&, unsigned char*, int) {
+    return -1;
+}
+
+#endif
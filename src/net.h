@@ -0,0 +1,161 @@
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+#include <vector>
+
+// First two bytes of every packet, so stray datagrams are ignored
+const unsigned short NET_PROTOCOL_ID = 0xA5F1;
+
+// Simulation steps per second on the server, one input command per step
+const int NET_TICK_RATE = 30;
+
+// Seconds one input command and one tick cover; client and server move the
+// player by the same step so predictions match
+const float NET_TICK_SECONDS = 1.0f / NET_TICK_RATE;
+
+// Largest datagram either side sends or accepts
+const int NET_MAX_PACKET = 65536;
+
+// Input commands repeated in every input packet, so one lost packet loses no input
+const int NET_INPUT_REDUNDANCY = 4;
+
+// Packet types, the byte after the protocol ID. Fields follow in order,
+// little-endian.
+enum PacketType {
+    PACKET_CONNECT = 1,    // Client asks for a slot
+    PACKET_WELCOME = 2,    // u8 slot, u32 server tick
+    PACKET_REJECT = 3,     // Server is full
+    PACKET_INPUT = 4,      // u32 newest snapshot tick received, u32 sequence number of
+                           // the newest command, u8 count, the commands newest first
+    PACKET_SNAPSHOT = 5,   // u32 tick, u32 baseline tick (0 = none), u32 newest input
+                           // sequence applied, then the delta (see snapshot.h)
+    PACKET_DISCONNECT = 6  // Either side leaves
+};
+
+// IPv4 address and port, both in host byte order
+struct NetAddress {
+    unsigned int host;
+    unsigned short port;
+    
+    NetAddress() : host(0), port(0) {}
+    NetAddress(unsigned int h, unsigned short p) : host(h), port(p) {}
+    
+    bool operator==(const NetAddress& other) const { return host == other.host && port == other.port; }
+};
+
+// Function to parse "host:port" (IPv4 dotted or "localhost"), returns false on bad input
+bool parseAddress(const std::string& text, NetAddress& address);
+
+// Function to format an address as "a.b.c.d:port"
+std::string formatAddress(const NetAddress& address);
+
+// Non-blocking UDP socket
+struct UdpSocket {
+    int fd;
+    unsigned long bytesSent;
+    unsigned long bytesReceived;
+    unsigned long packetsSent;
+    unsigned long packetsReceived;
+    
+    UdpSocket() : fd(-1), bytesSent(0), bytesReceived(0), packetsSent(0), packetsReceived(0) {}
+};
+
+// Function to open a UDP socket bound to a port on every interface (0 picks
+// a free one), returns false and sets error on failure
+bool openUdp(UdpSocket& sock, unsigned short port, std::string& error);
+
+// Function to close a socket
+void closeUdp(UdpSocket& sock);
+
+// Function to get the port a socket is bound to
+unsigned short boundPort(const UdpSocket& sock);
+
+// Function to send one datagram, returns false if it could not be queued
+bool sendPacket(UdpSocket& sock, const NetAddress& to, const unsigned char* data, int size);
+
+// Function to receive one waiting datagram, returns its size or -1 when
+// nothing is waiting
+int receivePacket(UdpSocket& sock, NetAddress& from, unsigned char* data, int capacity);
+
+// Appends little-endian fields to a packet
+struct PacketWriter {
+    std::vector<unsigned char> data;
+    
+    void clear() { data.clear(); }
+    int size() const { return (int)data.size(); }
+    
+    void u8(unsigned int v) { data.push_back((unsigned char)v); }
+    void u16(unsigned int v) { u8(v); u8(v >> 8); }
+    void u32(unsigned int v) { u16(v); u16(v >> 16); }
+    
+    // Function to write an unsigned value 7 bits per byte, small values in one byte
+    void varint(unsigned int v) {
+        while (v >= 0x80) {
+            u8((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        u8(v);
+    }
+    
+    // Function to write a signed value as a varint, small magnitudes in one byte
+    void svarint(int v) { varint(((unsigned int)v << 1) ^ (unsigned int)(v >> 31)); }
+    
+    void bytes(const unsigned char* p, int n) { data.insert(data.end(), p, p + n); }
+};
+
+// Reads the fields a PacketWriter wrote; reading past the end returns zeros
+// and clears ok, so callers check ok once after parsing
+struct PacketReader {
+    const unsigned char* data;
+    int size;
+    int offset;
+    bool ok;
+    
+    PacketReader(const unsigned char* d, int n) : data(d), size(n), offset(0), ok(true) {}
+    
+    unsigned int u8() {
+        if (offset >= size) {
+            ok = false;
+            return 0;
+        }
+        return data[offset++];
+    }
+    unsigned int u16() { unsigned int lo = u8(); return lo | (u8() << 8); }
+    unsigned int u32() { unsigned int lo = u16(); return lo | (u16() << 16); }
+    
+    unsigned int varint() {
+        unsigned int v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            unsigned int b = u8();
+            v |= (b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+    
+    int svarint() {
+        unsigned int v = varint();
+        return (int)(v >> 1) ^ -(int)(v & 1);
+    }
+    
+    bool atEnd() const { return offset >= size; }
+};
+
+// Function to start a packet with the protocol ID and a type
+inline void beginPacket(PacketWriter& w, PacketType type) {
+    w.clear();
+    w.u16(NET_PROTOCOL_ID);
+    w.u8(type);
+}
+
+// Function to check the protocol ID of a received packet and read its type,
+// returns 0 for packets that are not ours
+inline int readPacketType(PacketReader& r) {
+    if (r.u16() != NET_PROTOCOL_ID) return 0;
+    int type = (int)r.u8();
+    return r.ok ? type : 0;
+}
+
+#endif // NET_H
@@ -0,0 +1,135 @@
+#include "perf_counters.h"
+
+#include <cstring>
+
+#if defined(FPS_PERF_COUNTERS) && defined(__linux__)
+    #include <cerrno>
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define HAVE_PERF_EVENTS
+#endif
+
+bool perfCountersEnabled = false;
+
+static const char* COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+// Function to get the short name of a counter
+const char* perfCounterName(PerfCounter counter) {
+    return counter >= 0 && counter < PERF_COUNTER_COUNT ? COUNTER_NAMES[counter] : "?";
+}
+
+#ifdef HAVE_PERF_EVENTS
+
+static int counterFds[PERF_COUNTER_COUNT] = { -1, -1, -1, -1 };
+static int counterSlot[PERF_COUNTER_COUNT]; // Position of each counter in a group read
+static int groupSize = 0;
+
+// Function to open one hardware counter, in the group led by groupFd
+static int openCounter(unsigned long long config, int groupFd) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+// Function to open the counters for the calling thread
+bool openPerfCounters(std::string& error) {
+    static const unsigned long long CONFIGS[PERF_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    
+    closePerfCounters();
+    
+    // Cycles lead the group; without them nothing else is worth reading
+    counterFds[PERF_CYCLES] = openCounter(CONFIGS[PERF_CYCLES], -1);
+    if (counterFds[PERF_CYCLES] < 0) {
+        error = std::string("perf_event_open failed: ") + std::strerror(errno);
+        return false;
+    }
+    counterSlot[PERF_CYCLES] = 0;
+    groupSize = 1;
+    
+    // Members that the CPU does not support are left out
+    for (int i = 1; i < PERF_COUNTER_COUNT; i++) {
+        counterFds[i] = openCounter(CONFIGS[i], counterFds[PERF_CYCLES]);
+        if (counterFds[i] >= 0) {
+            counterSlot[i] = groupSize++;
+        }
+    }
+    
+    ioctl(counterFds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counterFds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perfCountersEnabled = true;
+    return true;
+}
+
+// Function to check whether a single counter could be opened
+bool perfCounterAvailable(PerfCounter counter) {
+    return counterFds[counter] >= 0;
+}
+
+// Function to read the raw running totals of every counter
+void readPerfCounters(PerfSample& sample) {
+    std::memset(&sample, 0, sizeof(sample));
+    if (counterFds[PERF_CYCLES] < 0) return;
+    
+    // Layout: nr, time_enabled, time_running, value[nr]
+    unsigned long long data[3 + PERF_COUNTER_COUNT];
+    if (read(counterFds[PERF_CYCLES], data, sizeof(data)) < (ssize_t)(3 * sizeof(unsigned long long))) return;
+    
+    // Raw totals; scaling a total by the whole run's multiplexing would let
+    // deltas between two reads come out wrong or even negative
+    sample.enabled = data[1];
+    sample.running = data[2];
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counterFds[i] >= 0 && counterSlot[i] < (int)data[0]) {
+            sample.values[i] = data[3 + counterSlot[i]];
+        }
+    }
+}
+
+// Function to close the counters
+void closePerfCounters() {
+    for (int i = PERF_COUNTER_COUNT - 1; i >= 0; i--) {
+        if (counterFds[i] >= 0) close(counterFds[i]);
+        counterFds[i] = -1;
+    }
+    groupSize = 0;
+    perfCountersEnabled = false;
+}
+
+#else
+
+// Counters are not available on this platform or build
+
+bool openPerfCounters(std::string& error) {
+    error = "hardware counters need Linux and a build with FPS_PERF_COUNTERS";
+    return false;
+}
+
+bool perfCounterAvailable(PerfCounter) {
+    return false;
+}
+
+void readPerfCounters(PerfSample& sample) {
+    std::memset(&sample, 0, sizeof(sample));
+}
+
+void closePerfCounters() {
+    perfCountersEnabled = false;
+}
+
+#endif
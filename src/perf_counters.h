@@ -0,0 +1,65 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+
+// Hardware performance counters through perf_event_open (Linux only).
+//
+// All counters are opened as one group on the calling thread, so a single
+// read returns a consistent snapshot. Where the kernel or the machine does
+// not allow them (containers, VMs, perf_event_paranoid) opening fails and
+// every read returns zeros.
+
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+// Raw counts as read, with the group's enabled and running times; the
+// kernel multiplexes groups that do not fit on the hardware, so deltas are
+// scaled by how long the group actually ran in between (see perfDelta)
+struct PerfSample {
+    unsigned long long values[PERF_COUNTER_COUNT];
+    unsigned long long enabled; // Nanoseconds the group was enabled
+    unsigned long long running; // Nanoseconds it was counting
+};
+
+// True while counters are open and being read around stages
+extern bool perfCountersEnabled;
+
+// Function to open the counters for the calling thread. Returns false and
+// explains why in error when none are available.
+bool openPerfCounters(std::string& error);
+
+// Function to check whether a single counter could be opened
+bool perfCounterAvailable(PerfCounter counter);
+
+// Function to read the raw running totals of every counter
+void readPerfCounters(PerfSample& sample);
+
+// Function to close the counters
+void closePerfCounters();
+
+// Function to get the short name of a counter
+const char* perfCounterName(PerfCounter counter);
+
+// Function to get how far a counter moved between two samples, scaled up
+// for the part of the interval the group was multiplexed off the hardware
+inline double perfDelta(const PerfSample& start, const PerfSample& end, int counter) {
+    double delta = (double)(end.values[counter] - start.values[counter]);
+    unsigned long long enabled = end.enabled - start.enabled;
+    unsigned long long running = end.running - start.running;
+    return running > 0 && running < enabled ? delta * enabled / running : delta;
+}
+
+// Function to add (end - start) to a running total
+inline void addPerfDelta(unsigned long long* total, const PerfSample& start, const PerfSample& end) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        total[i] += (unsigned long long)perfDelta(start, end, i);
+    }
+}
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,28 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64)
+    #define PLATFORM_WINDOWS
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #define PLATFORM_UNIX
+    #include <termios.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/ioctl.h>
+#endif
+
+// Hot kernels marked FPS_HOT_CLONES are compiled for several instruction
+// sets when building with FPS_MULTIVERSION; the loader picks the best one
+// for the running CPU.
+#if defined(FPS_MULTIVERSION) && defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+    #define FPS_HOT_CLONES __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+    #define FPS_HOT_CLONES
+#endif
+
+#endif // PLATFORM_H
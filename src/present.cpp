@@ -0,0 +1,198 @@
+#include "present.h"
+#include "game.h"
+#include "platform.h"
+#include "profile.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#ifdef PLATFORM_UNIX
+#include <poll.h>
+#endif
+
+// Unchanged cells between two changes in a row that are sent anyway rather
+// than moving the cursor past them, which costs about as many bytes
+static const int DIFF_MERGE_GAP = 6;
+
+// Most bytes one cell is encoded as: attributes, the glyph and a reset
+static const size_t MAX_CELL_BYTES = 12;
+
+// Most bytes one cursor move takes, "\033[row;colH"
+static const size_t MAX_MOVE_BYTES = 16;
+
+// Clear screen and move cursor to home position
+static const char FRAME_HEADER[] = "\033[2J\033[H";
+
+// Function to work out the most bytes a frame of this size can encode to:
+// every cell in color and, in a diff, a cursor move before every run of
+// changes, which are at least DIFF_MERGE_GAP cells apart
+static size_t maxEncodedBytes(int width, int height) {
+    size_t runs = (width + DIFF_MERGE_GAP) / (DIFF_MERGE_GAP + 1);
+    size_t row = width * MAX_CELL_BYTES + runs * MAX_MOVE_BYTES + 1;
+    return sizeof(FRAME_HEADER) - 1 + height * row;
+}
+
+// Function to append one cell with the colors of its glyph
+static inline void appendCell(std::string& out, char c, int x, int y, bool attributes) {
+    // Add color to bullets and trails with enhanced visibility
+    if (c == '#') {
+        out += attributes ? "\033[1;31m#\033[0m" : "\033[31m#\033[0m"; // Bright red for bullet center
+    } else if (c == 'X') {
+        out += attributes ? "\033[1;33mX\033[0m" : "\033[33mX\033[0m"; // Bright yellow for bullet middle
+    } else if (c == '*') {
+        out += attributes ? "\033[1;32m*\033[0m" : "\033[32m*\033[0m"; // Bright green for trail/outer edge
+    } else if (attributes && y == 2 && x >= 20 && x < 20 + (int)BULLET_ACTIVE_MSG.size()) {
+        // Special coloring for the bullet message area
+        if (c != ' ') {
+            out += "\033[5;31m"; // Blinking red for bullet message
+            out += c;
+            out += "\033[0m";
+        } else {
+            out += c;
+        }
+    } else {
+        out += c;
+    }
+}
+
+// Function to encode a framebuffer as ANSI terminal output
+FPS_HOT_CLONES
+void encodeFrame(const FrameBuffer& fb, std::string& out) {
+    out.clear();
+    
+    // Room for the busiest frame up front, so a frame with more colored
+    // cells than any before it does not grow the buffer mid-game
+    size_t most = maxEncodedBytes(fb.width, fb.height);
+    if (out.capacity() < most) out.reserve(most);
+    
+    out += FRAME_HEADER;
+    
+    // Without colors a row goes out as it is
+    if (renderQuality.colorDepth <= 0) {
+        for (int y = 0; y < fb.height; y++) {
+            out.append(fb.row(y), fb.width);
+            out += '\n';
+        }
+        return;
+    }
+    bool attributes = renderQuality.colorDepth >= 2;
+    
+    for (int y = 0; y < fb.height; y++) {
+        const char* line = fb.row(y);
+        for (int x = 0; x < fb.width; x++) {
+            appendCell(out, line[x], x, y, attributes);
+        }
+        out += '\n';
+    }
+}
+
+// Function to encode only the cells of a frame that differ from what the
+// terminal shows, as cursor moves followed by runs of cells
+FPS_HOT_CLONES
+void encodeFrameDiff(const FrameBuffer& fb, PresentedFrame& shown, std::string& out) {
+    out.clear();
+    
+    // Nothing is known about the screen after a resize or a color change:
+    // clear it and send every cell
+    bool everything = shown.screen.width != fb.width || shown.screen.height != fb.height ||
+                      shown.colorDepth != renderQuality.colorDepth;
+    if (everything) {
+        if (shown.screen.width != fb.width || shown.screen.height != fb.height) {
+            // Room for the busiest frame of the new size, see encodeFrame
+            size_t most = maxEncodedBytes(fb.width, fb.height);
+            if (out.capacity() < most) out.reserve(most);
+        }
+        shown.screen.resize(fb.width, fb.height);
+        shown.colorDepth = renderQuality.colorDepth;
+        out += "\033[2J";
+    }
+    bool colors = renderQuality.colorDepth > 0;
+    bool attributes = renderQuality.colorDepth >= 2;
+    
+    for (int y = 0; y < fb.height; y++) {
+        int begin = everything ? 0 : std::max(fb.dirty.begin[y], 0);
+        int end = everything ? fb.width : std::min(fb.dirty.end[y], fb.width);
+        const char* line = fb.row(y);
+        char* old = shown.screen.row(y);
+        
+        int x = begin;
+        while (x < end) {
+            if (!everything && line[x] == old[x]) {
+                x++;
+                continue;
+            }
+            
+            // Extend the run until DIFF_MERGE_GAP unchanged cells in a row
+            int runEnd = x + 1;
+            int scan = x + 1;
+            while (scan < end && scan - runEnd < DIFF_MERGE_GAP) {
+                if (everything || line[scan] != old[scan]) runEnd = scan + 1;
+                scan++;
+            }
+            
+            char move[24];
+            int length = std::snprintf(move, sizeof(move), "\033[%d;%dH", y + 1, x + 1);
+            out.append(move, length);
+            if (colors) {
+                for (int i = x; i < runEnd; i++) appendCell(out, line[i], i, y, attributes);
+            } else {
+                out.append(line + x, runEnd - x);
+            }
+            std::copy(line + x, line + runEnd, old + x);
+            x = scan;
+        }
+    }
+}
+
+// Function to write a buffer to the terminal in as few calls as possible
+void writeToTerminal(const char* data, size_t size) {
+    // Anything still queued on std::cout has to go out first
+    std::cout.flush();
+    
+#ifdef PLATFORM_UNIX
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(STDOUT_FILENO, data + written, size - written);
+        currentFrame.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Stdout shares the non-blocking open file of stdin on a
+                // tty, so a slow terminal pushes back: wait until it drains
+                pollfd out = { STDOUT_FILENO, POLLOUT, 0 };
+                if (poll(&out, 1, -1) < 0 && errno != EINTR) break;
+                continue;
+            }
+            break;
+        }
+        written += n;
+    }
+    currentFrame.bytesWritten += written;
+#else
+    std::cout.write(data, size);
+    std::cout.flush();
+    currentFrame.syscalls++;
+    currentFrame.bytesWritten += size;
+#endif
+}
+
+// Function to write the changed cells of a framebuffer to the terminal
+void presentFrame(FrameBuffer& fb) {
+    static std::string out;
+    static PresentedFrame shown;
+    static unsigned long messagesSeen = 0;
+    {
+        StageTimer timer(STAGE_ENCODE);
+        if (debugMessages != messagesSeen) {
+            // Debug output moved things around on screen behind our back
+            shown.colorDepth = -1;
+            messagesSeen = debugMessages;
+        }
+        encodeFrameDiff(fb, shown, out);
+        fb.dirty.reset(fb.height);
+    }
+    
+    StageTimer timer(STAGE_WRITE);
+    if (!out.empty()) writeToTerminal(out.data(), out.size());
+}
@@ -0,0 +1,32 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include "render.h"
+
+#include <cstddef>
+#include <string>
+
+// What the terminal currently shows, so later frames only send changes
+struct PresentedFrame {
+    FrameBuffer screen;
+    int colorDepth; // Color depth the screen was encoded with
+    
+    PresentedFrame() : colorDepth(-1) {}
+};
+
+// Function to encode a framebuffer as ANSI terminal output
+void encodeFrame(const FrameBuffer& fb, std::string& out);
+
+// Function to encode the dirty cells of a framebuffer that differ from what
+// the terminal shows, updating the shown copy; everything is sent after a
+// resize or a color depth change
+void encodeFrameDiff(const FrameBuffer& fb, PresentedFrame& shown, std::string& out);
+
+// Function to write a buffer to the terminal, counting bytes and write calls
+void writeToTerminal(const char* data, size_t size);
+
+// Function to write the changed cells of a framebuffer to the terminal and
+// mark it clean
+void presentFrame(FrameBuffer& fb);
+
+#endif // PRESENT_H
@@ -0,0 +1,77 @@
+#include "profile.h"
+#include "game.h"
+#include "render.h"
+
+// Stats of the frame in progress
+FrameStats currentFrame;
+
+static const char* STAGE_NAMES[STAGE_COUNT] = {
+    "input", "update", "raycast", "walls", "floor",
+    "sprites", "overlay", "encode", "write", "sleep"
+};
+
+// Allocation counters when the frame began
+static AllocCounters frameAllocStart;
+static unsigned long stageAllocStart[STAGE_COUNT + 1];
+
+// Function to snapshot the calling thread's allocation counts of every phase
+static void readStageAllocs(unsigned long* counts) {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        counts[i] = threadAllocationsInPhase(i).count;
+    }
+    counts[STAGE_COUNT] = threadAllocationsInPhase(ALLOC_PHASE_OTHER).count;
+}
+
+// Function to start collecting stats for a new frame
+void beginFrameStats(long frame) {
+    currentFrame.frame = frame;
+    currentFrame.startMs = nowMs();
+    currentFrame.frameMs = 0.0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        currentFrame.stageMs[i] = 0.0;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            currentFrame.stagePerf[i][c] = 0;
+        }
+    }
+    currentFrame.bytesWritten = 0;
+    currentFrame.syscalls = 0;
+    currentFrame.dropped = false;
+    currentFrame.networked = false;
+    currentFrame.corrections = 0;
+    currentFrame.predictionError = 0.0f;
+    
+    frameAllocStart = threadAllocationTotals();
+    readStageAllocs(stageAllocStart);
+}
+
+// Function to close the frame in progress
+void endFrameStats(double budgetMs) {
+    double end = nowMs();
+    currentFrame.frameMs = end - currentFrame.startMs;
+    if (tracingEnabled) traceComplete("frame", currentFrame.startMs, end);
+    currentFrame.dropped = budgetMs > 0.0 && currentFrame.frameMs > budgetMs;
+    
+    AllocCounters allocs = threadAllocationTotals();
+    currentFrame.allocations = allocs.count - frameAllocStart.count;
+    currentFrame.allocBytes = allocs.bytes - frameAllocStart.bytes;
+    readStageAllocs(currentFrame.stageAllocs);
+    for (int i = 0; i <= STAGE_COUNT; i++) {
+        currentFrame.stageAllocs[i] -= stageAllocStart[i];
+    }
+    
+    currentFrame.quality = qualityLevel;
+    
+    int aliveEnemies = 0;
+    for (const auto& enemy : enemies) {
+        if (enemy.alive) {
+            aliveEnemies++;
+        }
+    }
+    currentFrame.enemiesAlive = aliveEnemies;
+    currentFrame.bulletsActive = activeBullets;
+}
+
+// Function to get the short name of a stage
+const char* stageName(Stage stage) {
+    return stage >= 0 && stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
@@ -0,0 +1,90 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <chrono>
+#include <cstddef>
+
+#include "alloc_track.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+// Stages of a frame, main loop stages first, then the render passes
+enum Stage {
+    STAGE_INPUT,
+    STAGE_UPDATE,
+    STAGE_RAYCAST,
+    STAGE_WALLS,
+    STAGE_FLOOR,
+    STAGE_SPRITES,
+    STAGE_OVERLAY,
+    STAGE_ENCODE,
+    STAGE_WRITE,
+    STAGE_SLEEP,
+    STAGE_COUNT
+};
+
+// Everything measured about one frame
+struct FrameStats {
+    long frame;                    // Frame number
+    double startMs;                // Frame start since the clock epoch
+    double frameMs;                // Wall time of the frame, sleep excluded
+    double stageMs[STAGE_COUNT];   // Time spent in each stage
+    size_t bytesWritten;           // Bytes sent to the terminal
+    int syscalls;                  // Write calls made to present the frame
+    int enemiesAlive;
+    int bulletsActive;
+    int quality;                   // Quality level the frame was drawn at
+    bool dropped;                  // The frame missed its time budget
+    bool networked;                // Played against a server
+    int corrections;               // Predicted positions the server corrected
+    float predictionError;         // Cells the newest reconciliation was off by, 0 without one
+    unsigned long allocations;     // Heap allocations the frame's thread made during it
+    unsigned long allocBytes;      // Bytes those allocations requested
+    unsigned long stageAllocs[STAGE_COUNT + 1]; // Allocations per stage, last slot outside any stage
+    unsigned long long stagePerf[STAGE_COUNT][PERF_COUNTER_COUNT]; // Hardware counters per stage
+};
+
+// Stats of the frame in progress
+extern FrameStats currentFrame;
+
+// Function to get a monotonic timestamp in milliseconds
+inline double nowMs() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Function to start collecting stats for a new frame
+void beginFrameStats(long frame);
+
+// Function to close the frame in progress; budgetMs is the frame time budget
+void endFrameStats(double budgetMs);
+
+// Function to get the short name of a stage, as used in metrics and traces
+const char* stageName(Stage stage);
+
+// Adds the time between construction and destruction to a stage, records
+// it on the timeline when tracing, charges allocations to the stage and,
+// when hardware counters are open, reads them on both ends
+struct StageTimer {
+    Stage stage;
+    double start;
+    int previousPhase;
+    PerfSample perfStart;
+    
+    explicit StageTimer(Stage s) : stage(s), start(nowMs()), previousPhase(setAllocPhase(s)) {
+        if (perfCountersEnabled) readPerfCounters(perfStart);
+    }
+    ~StageTimer() {
+        if (perfCountersEnabled) {
+            PerfSample perfEnd;
+            readPerfCounters(perfEnd);
+            addPerfDelta(currentFrame.stagePerf[stage], perfStart, perfEnd);
+        }
+        double end = nowMs();
+        setAllocPhase(previousPhase);
+        currentFrame.stageMs[stage] += end - start;
+        if (tracingEnabled) traceComplete(stageName(stage), start, end);
+    }
+};
+
+#endif // PROFILE_H
@@ -0,0 +1,1179 @@
+#include "render.h"
+#include "game.h"
+#include "minimap.h"
+#include "platform.h"
+#include "profile.h"
+#include "shading.h"
+#include "textures.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+RenderQuality renderQuality = { 1, 0, false, 16.0f, true, true, true, 2, 2, BULLET_TRAIL_LENGTH };
+int qualityLevel = 0;
+bool temporalReuse = true;
+
+// Ray results and sprite IDs of the last frame; the columns are reused
+// between frames together with the static layer
+static GBuffer gbuffer;
+
+// Everything the walls, floor and ceiling of a frame depend on
+struct StaticLayerKey {
+    float x, y, a, fov, maxDepth;
+    unsigned int mapVersion;
+    int width, height;
+    int columnStep, refineSpan;
+    bool angularCache;
+    float viewDistance;
+    bool texturedWalls, castFloors, dither;
+};
+
+// Walls, floor and ceiling of the last cast frame, before sprites and overlays
+static FrameBuffer staticLayer;
+static StaticLayerKey staticLayerKey;
+static bool staticLayerValid = false;
+
+// Framebuffer the last frame was composed into and the serial number it was
+// given; while both match, its cells are still that frame
+static const FrameBuffer* composedTarget = NULL;
+static unsigned long composedSerial = 0;
+
+// Cells that have to be composed again this frame
+static DirtySpans composeRegion;
+
+// Cells sprites drew over since the last frame began. The next frame puts the
+// static layer back under them instead of copying the whole layer.
+static DirtySpans spriteDamage;
+
+// An overlay drawn on top of the scene, rasterized only when what it shows
+// changes. The raster is frame-sized; cells the overlay leaves alone hold 0.
+struct OverlayLayer {
+    FrameBuffer raster;
+    DirtySpans coverage;
+    bool valid;
+    
+    OverlayLayer() : valid(false) {}
+};
+
+// Everything the HUD's cells depend on
+struct HudState {
+    int width, height;
+    int enemies, fired, active, quality;
+    int room; // Columns left of the mini-map
+};
+
+static OverlayLayer miniMapLayer;
+static MiniMapState miniMapLayerState;
+static OverlayLayer hudLayer;
+static HudState hudLayerState;
+
+// Function to build the static layer key for the frame about to be drawn
+static StaticLayerKey currentStaticLayerKey(const FrameBuffer& fb) {
+    StaticLayerKey key;
+    key.x = playerX;
+    key.y = playerY;
+    key.a = playerA;
+    key.fov = playerFOV;
+    key.maxDepth = maxDepth;
+    key.mapVersion = mapVersion;
+    key.width = fb.width;
+    key.height = fb.height;
+    key.columnStep = renderQuality.columnStep;
+    key.refineSpan = renderQuality.refineSpan;
+    key.angularCache = renderQuality.angularCache;
+    key.viewDistance = renderQuality.viewDistance;
+    key.texturedWalls = renderQuality.texturedWalls;
+    key.castFloors = renderQuality.castFloors;
+    key.dither = renderQuality.dither;
+    return key;
+}
+
+// Function to compare two static layer keys
+static bool sameStaticLayer(const StaticLayerKey& a, const StaticLayerKey& b) {
+    return a.x == b.x && a.y == b.y && a.a == b.a && a.fov == b.fov && a.maxDepth == b.maxDepth &&
+           a.mapVersion == b.mapVersion && a.width == b.width && a.height == b.height &&
+           a.columnStep == b.columnStep && a.refineSpan == b.refineSpan && a.angularCache == b.angularCache &&
+           a.viewDistance == b.viewDistance &&
+           a.texturedWalls == b.texturedWalls && a.castFloors == b.castFloors && a.dither == b.dither;
+}
+
+// Function to work out where the wall slice of a column starts and ends
+static inline void wallSpan(float distanceToWall, int height, int& ceiling, int& floor) {
+    ceiling = (float)(height / 2.0) - height / ((float)distanceToWall);
+    floor = height - ceiling;
+}
+
+// Distance a ray advances per step while marching
+static const float RAY_STEP = 0.1f;
+
+// Distances the marcher reaches after each step, summed the way it sums them
+// so analytic hits round to exactly the same values
+static const int MARCH_TABLE_SIZE = 1024;
+
+static const float* marchDistances() {
+    static float table[MARCH_TABLE_SIZE];
+    static bool filled = false;
+    if (!filled) {
+        float distance = 0.0f;
+        for (int i = 0; i < MARCH_TABLE_SIZE; i++) {
+            table[i] = distance;
+            distance += RAY_STEP;
+        }
+        filled = true;
+    }
+    return table;
+}
+
+// Per-column ray tables for one screen width and field of view
+struct ColumnTables {
+    int width;
+    float fov;
+    std::vector<float> offset;     // Where the column crosses the camera plane, -tan(fov/2) to tan(fov/2)
+    std::vector<float> correction; // Cosine of the angle between the column's ray and the view direction
+    std::vector<float> angle;      // Angle of the column's ray from the view direction
+    
+    ColumnTables() : width(0), fov(0.0f) {}
+};
+
+static ColumnTables columnTables;
+
+// Everything needed to cast rays for the frame in progress
+struct RayCamera {
+    float dirX, dirY;         // Unit view direction
+    float planeX, planeY;     // Unit vector along the camera plane, towards the right of the screen
+    const float* offset;      // Camera-plane offset of every column
+    const float* correction;  // Perpendicular distance per unit of ray distance, per column
+    const float* angle;       // Angle of every column from the view direction
+    float viewDistance;
+    bool angular;             // Take rays from the angular cache
+};
+
+// Rays by absolute angle for the current position, so a camera that only
+// turns casts just the rays that come into view. Bins are one centre column
+// apart, so turning is in effect quantised to whole columns.
+struct AngularCache {
+    int width;
+    float fov;
+    int bins;
+    float binAngle;
+    std::vector<ColumnHit> hits;      // Depth along the ray, not perpendicular
+    std::vector<unsigned int> stamp;  // Generation each bin was cast in
+    unsigned int generation;
+    float x, y, viewDistance;         // What the cached rays are valid for
+    unsigned int mapVersion;
+    
+    AngularCache() : width(0), fov(0.0f), bins(0), binAngle(0.0f), generation(0),
+                     x(0.0f), y(0.0f), viewDistance(0.0f), mapVersion(0) {}
+};
+
+static AngularCache angularCache;
+
+// Rays marched since castRays started
+static int raysCast = 0;
+
+// Function to build the per-column tables when the width or field of view changes
+static const ColumnTables& columnTablesFor(int width) {
+    ColumnTables& t = columnTables;
+    if (t.width != width || t.fov != playerFOV) {
+        t.width = width;
+        t.fov = playerFOV;
+        t.offset.resize(width);
+        t.correction.resize(width);
+        t.angle.resize(width);
+        
+        // Columns are spread evenly over the camera plane, so straight walls stay straight
+        float halfPlane = tan(playerFOV / 2.0f);
+        for (int x = 0; x < width; x++) {
+            float offset = halfPlane * (2.0f * x / width - 1.0f);
+            t.offset[x] = offset;
+            t.correction[x] = 1.0f / sqrt(1.0f + offset * offset);
+            t.angle[x] = atan(offset);
+        }
+    }
+    return t;
+}
+
+// Function to set up the camera for casting rays this frame
+static RayCamera rayCamera(int width, float viewDistance) {
+    const ColumnTables& t = columnTablesFor(width);
+    RayCamera cam;
+    cam.dirX = sin(playerA);
+    cam.dirY = cos(playerA);
+    cam.planeX = cam.dirY;
+    cam.planeY = -cam.dirX;
+    cam.offset = &t.offset[0];
+    cam.correction = &t.correction[0];
+    cam.angle = &t.angle[0];
+    cam.viewDistance = viewDistance;
+    cam.angular = false;
+    return cam;
+}
+
+// Function to get the unit direction of the ray through a screen column
+static inline void columnRay(const RayCamera& cam, int x, float& rayDirX, float& rayDirY) {
+    float offset = cam.offset[x];
+    float correction = cam.correction[x];
+    rayDirX = (cam.dirX + cam.planeX * offset) * correction;
+    rayDirY = (cam.dirY + cam.planeY * offset) * correction;
+}
+
+// Function to intersect a ray with the face of a wall cell that looks
+// towards the player. Gives the exact distance along the ray and where along
+// the face it lands (0 to 1, left to right as seen from the front).
+static inline float faceIntersection(int cellX, int cellY, int side, float rayDirX, float rayDirY, float& u) {
+    float distance, along;
+    if (side == 0) {
+        float plane = (float)(playerX < cellX ? cellX : cellX + 1);
+        distance = (plane - playerX) / rayDirX;
+        along = playerY + rayDirY * distance;
+        u = along - std::floor(along);
+        if (playerX > cellX) u = 1.0f - u;
+    } else {
+        float plane = (float)(playerY < cellY ? cellY : cellY + 1);
+        distance = (plane - playerY) / rayDirY;
+        along = playerX + rayDirX * distance;
+        u = along - std::floor(along);
+        if (playerY < cellY) u = 1.0f - u;
+    }
+    return distance;
+}
+
+// Function to march a ray until it hits a wall; the hit depth is the
+// distance along the ray
+static inline ColumnHit marchRay(float rayDirX, float rayDirY, float viewDistance) {
+    // Distance to wall
+    float distanceToWall = 0.0f;
+    bool hitWall = false;
+    
+    // Step size
+    float stepSize = RAY_STEP;
+    
+    // Ray position
+    float rayX = playerX;
+    float rayY = playerY;
+    
+    // Cell the previous step was in, to tell which face the ray came through
+    int lastCellX = (int)playerX;
+    
+    ColumnHit hit;
+    hit.cell = -1;
+    hit.side = 0;
+    hit.u = 0.0f;
+    raysCast++;
+    
+    while (!hitWall && distanceToWall < viewDistance) {
+        distanceToWall += stepSize;
+        rayX = playerX + rayDirX * distanceToWall;
+        rayY = playerY + rayDirY * distanceToWall;
+        
+        // Check if ray is out of bounds
+        if (rayX < 0 || rayX >= mapWidth || rayY < 0 || rayY >= mapHeight) {
+            hitWall = true;
+            distanceToWall = viewDistance;
+        }
+        else {
+            // Check if ray hit a wall
+            int cellX = (int)rayX;
+            int cellY = (int)rayY;
+            if (map[cellY * mapWidth + cellX] == '#') {
+                hitWall = true;
+                hit.cell = cellY * mapWidth + cellX;
+                hit.side = cellX != lastCellX ? 0 : 1;
+                faceIntersection(cellX, cellY, hit.side, rayDirX, rayDirY, hit.u);
+            }
+            lastCellX = cellX;
+        }
+    }
+    
+    hit.depth = distanceToWall;
+    return hit;
+}
+
+// Function to size the angular cache for a screen width, emptying it when
+// the width or field of view changes
+static void sizeAngularCache(int width) {
+    AngularCache& c = angularCache;
+    if (c.width != width || c.fov != playerFOV) {
+        // One bin per column at the centre of the screen, where columns are widest apart
+        float binAngle = atan(2.0f * tan(playerFOV / 2.0f) / width);
+        c.width = width;
+        c.fov = playerFOV;
+        c.bins = (int)ceil(2.0f * 3.14159265f / binAngle);
+        c.binAngle = 2.0f * 3.14159265f / c.bins;
+        c.hits.resize(c.bins);
+        c.stamp.assign(c.bins, 0);
+        c.generation = 0;
+    }
+}
+
+// Function to start a frame in the angular cache: a new position, map or
+// view distance makes every cached ray stale
+static void prepareAngularCache(int width, float viewDistance) {
+    AngularCache& c = angularCache;
+    sizeAngularCache(width);
+    if (c.generation == 0 || c.x != playerX || c.y != playerY || c.viewDistance != viewDistance ||
+        c.mapVersion != mapVersion) {
+        c.x = playerX;
+        c.y = playerY;
+        c.viewDistance = viewDistance;
+        c.mapVersion = mapVersion;
+        c.generation++;
+    }
+}
+
+// Function to cast the ray of one screen column
+static inline ColumnHit castColumn(const RayCamera& cam, int x) {
+    ColumnHit hit;
+    if (cam.angular) {
+        // Snap the column to the nearest cached angle, casting it if it is new
+        AngularCache& c = angularCache;
+        int bin = (int)std::floor((playerA + cam.angle[x]) / c.binAngle + 0.5f) % c.bins;
+        if (bin < 0) bin += c.bins;
+        if (c.stamp[bin] != c.generation) {
+            float rayAngle = bin * c.binAngle;
+            c.hits[bin] = marchRay(sin(rayAngle), cos(rayAngle), cam.viewDistance);
+            c.stamp[bin] = c.generation;
+        }
+        hit = c.hits[bin];
+    } else {
+        // Calculate ray position and direction
+        float rayDirX, rayDirY;
+        columnRay(cam, x, rayDirX, rayDirY);
+        hit = marchRay(rayDirX, rayDirY, cam.viewDistance);
+    }
+    
+    // Walls are as tall as their distance in front of the camera, not along the ray
+    hit.depth *= cam.correction[x];
+    return hit;
+}
+
+// Function to fill the columns between two cast rays. Columns between two
+// hits on the same face of the same cell are interpolated, anything else
+// repeats the nearer ray.
+static inline void fillColumns(ColumnHit* hits, int left, int right) {
+    const ColumnHit& a = hits[left];
+    const ColumnHit& b = hits[right];
+    bool sameFace = a.cell >= 0 && a.cell == b.cell && a.side == b.side;
+    
+    for (int x = left + 1; x < right; x++) {
+        if (sameFace) {
+            float t = (float)(x - left) / (float)(right - left);
+            hits[x] = a;
+            hits[x].depth = a.depth + (b.depth - a.depth) * t;
+            hits[x].u = a.u + (b.u - a.u) * t;
+        } else {
+            hits[x] = (x - left <= right - x) ? a : b;
+        }
+    }
+}
+
+// Function to work out how many columns apart rays are cast at a width
+int columnStepFor(int width) {
+    if (renderQuality.columnStep == COLUMN_STEP_ADAPTIVE) {
+        return std::max(1, (width + ADAPTIVE_COLUMN_RAYS - 1) / ADAPTIVE_COLUMN_RAYS);
+    }
+    return std::max(renderQuality.columnStep, 1);
+}
+
+// Function to check whether every column between two hits must see the same
+// straight wall face: both on the face of one row (or column) of solid
+// cells, with nothing solid directly in front of that row
+static bool sameExposedFace(const ColumnHit& a, const ColumnHit& b) {
+    if (a.cell < 0 || b.cell < 0 || a.side != b.side) return false;
+    int ax = a.cell % mapWidth, ay = a.cell / mapWidth;
+    int bx = b.cell % mapWidth, by = b.cell / mapWidth;
+    
+    // Side 0 faces run along y at a fixed x, side 1 faces along x at a fixed y
+    int fixedA = a.side == 0 ? ax : ay;
+    int fixedB = b.side == 0 ? bx : by;
+    if (fixedA != fixedB) return false;
+    
+    float player = a.side == 0 ? playerX : playerY;
+    int front = fixedA + (player < fixedA ? -1 : 1);
+    int from = std::min(a.side == 0 ? ay : ax, a.side == 0 ? by : bx);
+    int to = std::max(a.side == 0 ? ay : ax, a.side == 0 ? by : bx);
+    for (int i = from; i <= to; i++) {
+        int wallCell = a.side == 0 ? i * mapWidth + fixedA : fixedA * mapWidth + i;
+        if (map[wallCell] != '#') return false;
+        if (front >= 0 && front < (a.side == 0 ? mapWidth : mapHeight)) {
+            int frontCell = a.side == 0 ? i * mapWidth + front : front * mapWidth + i;
+            if (map[frontCell] == '#') return false;
+        }
+    }
+    return true;
+}
+
+// Function to work out the hit on a known wall face without marching: the
+// exact distance to the face, rounded up to the step the marcher would stop on
+static inline ColumnHit faceHit(const RayCamera& cam, const ColumnHit& face, int x) {
+    int cellX = face.cell % mapWidth, cellY = face.cell / mapWidth;
+    
+    float rayDirX, rayDirY;
+    columnRay(cam, x, rayDirX, rayDirY);
+    
+    ColumnHit hit;
+    float distance = faceIntersection(cellX, cellY, face.side, rayDirX, rayDirY, hit.u);
+    int cell;
+    if (face.side == 0) {
+        int y = (int)(playerY + rayDirY * distance);
+        cell = std::max(0, std::min(y, mapHeight - 1)) * mapWidth + cellX;
+    } else {
+        int xCell = (int)(playerX + rayDirX * distance);
+        cell = cellY * mapWidth + std::max(0, std::min(xCell, mapWidth - 1));
+    }
+    
+    int steps = (int)std::floor(distance / RAY_STEP) + 1;
+    float depth = steps < MARCH_TABLE_SIZE ? marchDistances()[steps] : steps * RAY_STEP;
+    hit.depth = std::min(depth, cam.viewDistance) * cam.correction[x];
+    hit.cell = cell;
+    hit.side = face.side;
+    return hit;
+}
+
+// Function to cast the columns strictly between two cast columns, casting
+// the midpoint and recursing wherever the two hits could hide an edge
+static void refineColumns(const RayCamera& cam, ColumnHit* hits, int left, int right) {
+    if (right - left <= 1) return;
+    
+    if (sameExposedFace(hits[left], hits[right])) {
+        for (int x = left + 1; x < right; x++) {
+            hits[x] = faceHit(cam, hits[left], x);
+        }
+        return;
+    }
+    
+    int middle = (left + right) / 2;
+    hits[middle] = castColumn(cam, middle);
+    refineColumns(cam, hits, left, middle);
+    refineColumns(cam, hits, middle, right);
+}
+
+// Function to cast the rays for every screen column, reconstructing the
+// columns between rays when the column step is above one or refinement is
+// on; returns the number of rays actually cast
+FPS_HOT_CLONES
+int castRays(int width, ColumnHit* hits) {
+    RayCamera cam = rayCamera(width, std::min(maxDepth, renderQuality.viewDistance));
+    int step = columnStepFor(width);
+    raysCast = 0;
+    
+    if (renderQuality.angularCache) {
+        prepareAngularCache(width, cam.viewDistance);
+        cam.angular = true;
+    }
+    
+    if (step == 1 && renderQuality.refineSpan <= 1) {
+        for (int x = 0; x < width; x++) {
+            hits[x] = castColumn(cam, x);
+        }
+        return raysCast;
+    }
+    
+    // Cast every step-th column plus the last one, then fill in between
+    int span = step > 1 ? step : renderQuality.refineSpan;
+    int left = 0;
+    hits[0] = castColumn(cam, 0);
+    while (left < width - 1) {
+        int right = std::min(left + span, width - 1);
+        hits[right] = castColumn(cam, right);
+        if (step > 1) {
+            fillColumns(hits, left, right);
+        } else {
+            refineColumns(cam, hits, left, right);
+        }
+        left = right;
+    }
+    return raysCast;
+}
+
+// Function to draw the ceiling and wall slice of every column
+FPS_HOT_CLONES
+void drawWalls(FrameBuffer& fb, const ColumnHit* hits) {
+    const unsigned char (*thresholds)[4] = ditherThresholds();
+    for (int x = 0; x < fb.width; x++) {
+        float distanceToWall = hits[x].depth;
+        
+        // Calculate wall height
+        int ceiling, floor;
+        wallSpan(distanceToWall, fb.height, ceiling, floor);
+        int end = std::min(floor, fb.height - 1);
+        
+        // Textured walls come from the column cache
+        if (renderQuality.texturedWalls && hits[x].cell >= 0) {
+            int texture = wallTexture(hits[x].cell);
+            int u = std::min((int)(hits[x].u * TEXTURE_SIZE), TEXTURE_SIZE - 1);
+            const char* column = texturedColumn(texture, u, ceiling, fb.height, x & 3);
+            if (column) {
+                for (int y = 0; y <= end; y++) {
+                    fb.at(x, y) = column[y];
+                }
+            } else {
+                // Too close to cache, sample the texture directly
+                int span = floor - ceiling + 1;
+                int shade = wallShade(distanceToWall);
+                for (int y = 0; y <= end; y++) {
+                    int v = std::min((y - ceiling) * TEXTURE_SIZE / span, TEXTURE_SIZE - 1);
+                    fb.at(x, y) = wallGlyph(texture, u, v, shade, thresholds[y & 3][x & 3]);
+                }
+            }
+            continue;
+        }
+        
+        // Shade walls based on distance, one glyph per row of the dither
+        // pattern. A ray that hit nothing stopped at the view distance, which
+        // the fisheye correction pulls nearer off centre; it stays blank.
+        int shade = hits[x].cell >= 0 ? wallShade(distanceToWall) : WALL_SHADE_BLANK;
+        char glyphs[4];
+        for (int i = 0; i < 4; i++) {
+            glyphs[i] = shadeGlyph(WALL_RAMP, shade, thresholds[i][x & 3]);
+        }
+        
+        // Draw walls: blank ceiling down to the slice, then the slice
+        int top = std::min(std::max(ceiling, 0), end + 1);
+        for (int y = 0; y < top; y++) {
+            fb.at(x, y) = ' ';
+        }
+        for (int y = top; y <= end; y++) {
+            fb.at(x, y) = glyphs[y & 3];
+        }
+    }
+}
+
+// Per-row distances for one screen height: how far in front of the camera
+// the floor (or ceiling) seen in each row is
+struct RowTables {
+    int height;
+    std::vector<float> distance;
+    
+    RowTables() : height(0) {}
+};
+
+static RowTables rowTables;
+
+// First row of every column that is not ceiling, reused between frames
+static std::vector<int> columnCeilings;
+
+// One row each of dark floor, light floor and beam glyphs in the dither
+// pattern of the row being cast
+static std::vector<char> ditherRows;
+
+// Floor glyphs of every row and dither phase, for the row-shaded floor
+static std::vector<char> floorRowGlyphs;
+// Width of the ceiling beams along the cell borders, in cells
+static const float BEAM_WIDTH = 0.08f;
+
+// Function to build the per-row distances when the height changes
+static const float* rowDistancesFor(int height) {
+    RowTables& t = rowTables;
+    if (t.height != height) {
+        t.height = height;
+        t.distance.resize(height);
+        // A point on the floor at distance d shows up height / d rows below the horizon
+        for (int y = 0; y < height; y++) {
+            float rows = fabs(y - height / 2.0f);
+            t.distance[y] = rows > 0.0f ? height / rows : 1e30f;
+        }
+    }
+    return &t.distance[0];
+}
+
+// Function to fill a row with four glyphs repeating, one per dither phase;
+// the row must have room for width rounded up to a multiple of four
+static inline void fillPattern(char* row, int width, const char* glyphs) {
+    for (int x = 0; x < width; x += 4) {
+        std::memcpy(row + x, glyphs, 4);
+    }
+}
+
+// Function to cast the floor and ceiling row by row. Every row lies at one
+// distance, so its world position only needs one step per column and no
+// divide; cells below the wall slices get a checkered tile floor, cells above
+// them ceiling beams along the cell borders.
+FPS_HOT_CLONES
+static void castFloorAndCeiling(FrameBuffer& fb, const ColumnHit* hits) {
+    int width = fb.width;
+    int height = fb.height;
+    
+    columnCeilings.resize(width);
+    int* ceilings = &columnCeilings[0];
+    for (int x = 0; x < width; x++) {
+        int ceiling, floor;
+        wallSpan(hits[x].depth, height, ceiling, floor);
+        ceilings[x] = ceiling;
+    }
+    
+    const float* rowDistance = rowDistancesFor(height);
+    const unsigned char (*thresholds)[4] = ditherThresholds();
+    int patternWidth = (width + 3) & ~3;
+    ditherRows.resize(3 * patternWidth);
+    char* darkRow = &ditherRows[0];
+    char* lightRow = darkRow + patternWidth;
+    char* beamRow = lightRow + patternWidth;
+    RayCamera cam = rayCamera(width, renderQuality.viewDistance);
+    float columnStep = 2.0f * -cam.offset[0] / width;
+    float mapW = (float)mapWidth;
+    float mapH = (float)mapHeight;
+    
+    for (int y = 0; y < height; y++) {
+        float distance = rowDistance[y];
+        int shade = floorShade(distance);
+        if (shade >= FLOOR_SHADE_BLANK) continue;
+        
+        // World position seen by the leftmost column and the step per column;
+        // positions are start + x * step so the column loops vectorise
+        float worldX = playerX + distance * (cam.dirX + cam.planeX * cam.offset[0]);
+        float worldY = playerY + distance * (cam.dirY + cam.planeY * cam.offset[0]);
+        float stepX = distance * cam.planeX * columnStep;
+        float stepY = distance * cam.planeY * columnStep;
+        char* row = fb.row(y);
+        
+        // The dither pattern repeats every four columns, so lay the row's
+        // glyphs out once and let the column loops pick from them
+        const unsigned char* threshold = thresholds[y & 3];
+        if (y > height / 2) {
+            char darkGlyphs[4], lightGlyphs[4];
+            for (int i = 0; i < 4; i++) {
+                darkGlyphs[i] = shadeGlyph(FLOOR_RAMP, shade, threshold[i]);
+                lightGlyphs[i] = shadeGlyph(FLOOR_RAMP, shade + SHADE_BAND, threshold[i]);
+            }
+            fillPattern(darkRow, width, darkGlyphs);
+            fillPattern(lightRow, width, lightGlyphs);
+            
+            int firstRow = height - y;
+            for (int x = 0; x < width; x++) {
+                float wx = worldX + x * stepX;
+                float wy = worldY + x * stepY;
+                bool inside = (wx >= 0.0f) & (wy >= 0.0f) & (wx < mapW) & (wy < mapH);
+                bool lightTile = (((int)wx + (int)wy) & 1) != 0;
+                char dark = darkRow[x];
+                char light = lightRow[x];
+                char glyph = inside ? (lightTile ? light : dark) : ' ';
+                row[x] = ceilings[x] > firstRow ? glyph : row[x];
+            }
+        } else {
+            char beamGlyphs[4];
+            for (int i = 0; i < 4; i++) {
+                beamGlyphs[i] = shadeGlyph(CEILING_RAMP, shade, threshold[i]);
+            }
+            fillPattern(beamRow, width, beamGlyphs);
+            
+            for (int x = 0; x < width; x++) {
+                float wx = worldX + x * stepX;
+                float wy = worldY + x * stepY;
+                bool inside = (wx >= 0.0f) & (wy >= 0.0f) & (wx < mapW) & (wy < mapH);
+                bool onBeam = (wx - (int)wx < BEAM_WIDTH) | (wy - (int)wy < BEAM_WIDTH);
+                char beam = beamRow[x];
+                char glyph = inside & onBeam ? beam : ' ';
+                row[x] = ceilings[x] > y ? glyph : row[x];
+            }
+        }
+    }
+}
+
+// Function to shade the floor below every wall slice, and the ceiling above
+// them when floor casting is on
+FPS_HOT_CLONES
+void drawFloor(FrameBuffer& fb, const ColumnHit* hits) {
+    if (renderQuality.castFloors) {
+        castFloorAndCeiling(fb, hits);
+        return;
+    }
+    
+    // Shade floor based on distance: every row lies at one distance, so its
+    // glyphs for the four dither phases are worked out once
+    const float* rowDistance = rowDistancesFor(fb.height);
+    const unsigned char (*thresholds)[4] = ditherThresholds();
+    floorRowGlyphs.resize(fb.height * 4);
+    for (int y = fb.height / 2; y < fb.height; y++) {
+        int shade = floorShade(rowDistance[y]);
+        for (int i = 0; i < 4; i++) {
+            floorRowGlyphs[y * 4 + i] = shadeGlyph(FLOOR_RAMP, shade, thresholds[y & 3][i]);
+        }
+    }
+    
+    for (int x = 0; x < fb.width; x++) {
+        int ceiling, floor;
+        wallSpan(hits[x].depth, fb.height, ceiling, floor);
+        
+        const char* glyphs = &floorRowGlyphs[x & 3];
+        for (int y = std::max(floor + 1, fb.height / 2); y < fb.height; y++) {
+            fb.at(x, y) = glyphs[y * 4];
+        }
+    }
+}
+
+// Sprite positions gathered for projection and where they land on screen.
+// Kept as separate arrays so the projection loop vectorises.
+struct SpriteBatch {
+    std::vector<float> x, y;     // World position
+    std::vector<float> depth;    // Distance in front of the camera, <= 0 behind it
+    std::vector<float> screenX;  // Screen column of the centre
+    std::vector<int> id;         // Sprite ID, for enemies and players
+    int count;
+    
+    SpriteBatch() : count(0) {}
+    
+    void reset(int n) {
+        if ((int)x.size() < n) {
+            x.resize(n);
+            y.resize(n);
+            depth.resize(n);
+            screenX.resize(n);
+            id.resize(n);
+        }
+        count = n;
+    }
+};
+
+static SpriteBatch enemyBatch;
+static SpriteBatch playerBatch;
+static SpriteBatch bulletBatch;
+
+// Function to transform every sprite of a batch into camera space: depth is
+// the distance along the view direction, screenX follows from the offset
+// along the camera plane, the same plane the wall rays go through
+FPS_HOT_CLONES
+static void projectSprites(SpriteBatch& batch, int width) {
+    float dirX = sin(playerA);
+    float dirY = cos(playerA);
+    float halfWidth = width / 2.0f;
+    float scale = halfWidth / tan(playerFOV / 2.0f);
+    
+    const float* xs = batch.x.data();
+    const float* ys = batch.y.data();
+    float* depths = batch.depth.data();
+    float* screenXs = batch.screenX.data();
+    for (int i = 0; i < batch.count; i++) {
+        float relX = xs[i] - playerX;
+        float relY = ys[i] - playerY;
+        float depth = relX * dirX + relY * dirY;
+        float lateral = relX * dirY - relY * dirX;
+        depths[i] = depth;
+        screenXs[i] = halfWidth + lateral * scale / depth;
+    }
+}
+
+// Function to check whether a projected sprite is in front of the camera and inside the view
+static inline bool spriteVisible(const SpriteBatch& batch, int i, int width) {
+    return batch.depth[i] > 0.01f && batch.screenX[i] >= 0.0f && batch.screenX[i] < width;
+}
+
+// Function to get the sprite ID buffer, sized for the framebuffer being drawn
+static int* spriteIdsFor(const FrameBuffer& fb) {
+    GBuffer& g = gbuffer;
+    if (g.width != fb.width || g.height != fb.height) {
+        g.width = fb.width;
+        g.height = fb.height;
+        g.sprites.assign(fb.width * fb.height, SPRITE_NONE);
+    }
+    return &g.sprites[0];
+}
+
+// Function to clear the sprite IDs in the cells sprites drew over; nothing
+// else writes IDs, so that leaves the whole buffer clear
+static void clearSpriteIds(const DirtySpans& drawn) {
+    GBuffer& g = gbuffer;
+    int rows = std::min(g.height, (int)drawn.begin.size());
+    for (int y = 0; y < rows; y++) {
+        int x1 = std::min(drawn.end[y], g.width);
+        if (drawn.begin[y] >= x1) continue;
+        int* row = &g.sprites[y * g.width];
+        std::fill(row + drawn.begin[y], row + x1, SPRITE_NONE);
+    }
+}
+
+// Function to mark a sprite rectangle, clipped to the frame, as drawn over
+static void touchSprite(FrameBuffer& fb, int x0, int y0, int x1, int y1) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, fb.width);
+    y1 = std::min(y1, fb.height);
+    if (x0 >= x1 || y0 >= y1) return;
+    fb.markDirty(x0, y0, x1, y1);
+    spriteDamage.add(x0, y0, x1, y1);
+}
+
+// Function to draw a projected batch of standing figures, as tall as a wall
+// at their distance and half as wide
+static void drawFigures(FrameBuffer& fb, const SpriteBatch& batch, char glyph) {
+    int renderWidth = fb.width;
+    int renderHeight = fb.height;
+    int* ids = spriteIdsFor(fb);
+    
+    for (int i = 0; i < batch.count; i++) {
+        if (!spriteVisible(batch, i, renderWidth)) continue;
+        
+        // Calculate figure height and position on screen
+        int figureHeight = (int)(renderHeight / batch.depth[i]);
+        int figureCenter = (int)batch.screenX[i];
+        touchSprite(fb, figureCenter - figureHeight / 4, renderHeight / 2 - figureHeight / 2,
+                    figureCenter - figureHeight / 4 + std::min(figureHeight / 2, renderWidth),
+                    renderHeight / 2 - figureHeight / 2 + std::min(figureHeight, renderHeight));
+        
+        // Draw figure
+        for (int y = 0; y < figureHeight && y < renderHeight; y++) {
+            for (int x = 0; x < figureHeight / 2 && x < renderWidth; x++) {
+                int drawY = renderHeight / 2 - figureHeight / 2 + y;
+                int drawX = figureCenter - figureHeight / 4 + x;
+                
+                if (drawX >= 0 && drawX < renderWidth && drawY >= 0 && drawY < renderHeight) {
+                    fb.at(drawX, drawY) = glyph;
+                    ids[drawY * renderWidth + drawX] = batch.id[i];
+                }
+            }
+        }
+    }
+}
+
+// Function to draw enemies
+void drawEnemies(FrameBuffer& fb) {
+    // Project every living enemy in one pass
+    SpriteBatch& batch = enemyBatch;
+    batch.reset((int)enemies.size());
+    int count = 0;
+    for (size_t e = 0; e < enemies.size(); e++) {
+        if (enemies[e].alive) {
+            batch.x[count] = enemies[e].x;
+            batch.y[count] = enemies[e].y;
+            batch.id[count] = enemySpriteId((int)e);
+            count++;
+        }
+    }
+    batch.count = count;
+    projectSprites(batch, fb.width);
+    drawFigures(fb, batch, 'E');
+}
+
+// Function to draw the other players of a network game
+void drawPlayers(FrameBuffer& fb) {
+    if (remotePlayers.empty()) return;
+    
+    SpriteBatch& batch = playerBatch;
+    batch.reset((int)remotePlayers.size());
+    for (size_t p = 0; p < remotePlayers.size(); p++) {
+        batch.x[p] = remotePlayers[p].x;
+        batch.y[p] = remotePlayers[p].y;
+        batch.id[p] = playerSpriteId((int)p);
+    }
+    projectSprites(batch, fb.width);
+    drawFigures(fb, batch, 'P');
+}
+
+// Function to draw bullets and their trails
+void drawBullets(FrameBuffer& fb) {
+    int renderWidth = fb.width;
+    int renderHeight = fb.height;
+    
+    // Project every bullet and trail point in one pass, BULLET_TRAIL_LENGTH
+    // points per bullet with the bullet itself first
+    SpriteBatch& batch = bulletBatch;
+    batch.reset((int)bullets.size() * BULLET_TRAIL_LENGTH);
+    for (size_t b = 0; b < bullets.size(); b++) {
+        for (int t = 0; t < BULLET_TRAIL_LENGTH; t++) {
+            int i = (int)b * BULLET_TRAIL_LENGTH + t;
+            batch.x[i] = t == 0 ? bullets[b].x : bullets[b].trailX[t];
+            batch.y[i] = t == 0 ? bullets[b].y : bullets[b].trailY[t];
+        }
+    }
+    projectSprites(batch, renderWidth);
+    int* ids = spriteIdsFor(fb);
+    
+    int trailLength = std::min(renderQuality.trailLength, BULLET_TRAIL_LENGTH);
+    for (size_t b = 0; b < bullets.size(); b++) {
+        int first = (int)b * BULLET_TRAIL_LENGTH;
+        if (bullets[b].active && spriteVisible(batch, first, renderWidth)) {
+            // Calculate bullet position on screen
+            int bulletCenter = (int)batch.screenX[first];
+            int id = bulletSpriteId((int)b);
+            
+            // Draw the main bullet with MUCH larger, high-contrast characters
+            // Use a large block of characters to create a very visible bullet,
+            // shrinking it when the governor lowers sprite detail
+            int radius = renderQuality.spriteDetail >= 2 ? 5 : (renderQuality.spriteDetail == 1 ? 3 : 0);
+            touchSprite(fb, bulletCenter - radius, renderHeight / 2 - radius,
+                        bulletCenter + radius + 1, renderHeight / 2 + radius + 1);
+            for (int y = renderHeight / 2 - radius; y <= renderHeight / 2 + radius; y++) {
+                for (int x = bulletCenter - radius; x <= bulletCenter + radius; x++) {
+                    if (y >= 0 && y < renderHeight && x >= 0 && x < renderWidth) {
+                        // Distance from center to determine what character to use
+                        int distFromCenter = abs(y - renderHeight / 2) + abs(x - bulletCenter);
+                        
+                        // Create a pattern for the bullet that makes it VERY visible
+                        if (distFromCenter <= 3) {
+                            // Use solid block for center
+                            fb.at(x, y) = '#';
+                            ids[y * renderWidth + x] = id;
+                        } else if (distFromCenter <= 5) {
+                            // Use X for outer part
+                            fb.at(x, y) = 'X';
+                            ids[y * renderWidth + x] = id;
+                        } else if (distFromCenter <= 8) {
+                            // Use asterisk for outer edge
+                            fb.at(x, y) = '*';
+                            ids[y * renderWidth + x] = id;
+                        }
+                    }
+                }
+            }
+            
+            // Draw the bullet trail, skipping the first position as it's
+            // already drawn as the main bullet
+            for (int t = 1; t < trailLength; t++) {
+                if (!spriteVisible(batch, first + t, renderWidth)) continue;
+                int trailCenter = (int)batch.screenX[first + t];
+                touchSprite(fb, trailCenter - 1, renderHeight / 2 - 1, trailCenter + 2, renderHeight / 2 + 2);
+                
+                // Draw trail segment (smaller than the main bullet)
+                for (int y = renderHeight / 2 - 1; y <= renderHeight / 2 + 1; y++) {
+                    for (int x = trailCenter - 1; x <= trailCenter + 1; x++) {
+                        if (y >= 0 && y < renderHeight && x >= 0 && x < renderWidth) {
+                            // Use a different character for the trail
+                            fb.at(x, y) = '*';
+                            ids[y * renderWidth + x] = id;
+                        }
+                    }
+                }
+            }
+            
+            #ifdef PLATFORM_UNIX
+            // Add a prominent debug message at the top of the screen
+            if (2 < renderHeight) touchSprite(fb, 20, 2, 20 + (int)BULLET_ACTIVE_MSG.size(), 3);
+            for (size_t i = 0; i < BULLET_ACTIVE_MSG.size() && (int)i + 20 < renderWidth && 2 < renderHeight; i++) {
+                fb.at(i + 20, 2) = BULLET_ACTIVE_MSG[i];
+            }
+            #endif
+        }
+    }
+}
+
+// Function to draw the crosshair and stats line
+void drawHud(FrameBuffer& fb) {
+    int renderWidth = fb.width;
+    
+    // Draw crosshair
+    fb.at(renderWidth / 2, fb.height / 2) = '+';
+    
+    // Draw stats
+    int aliveEnemies = 0;
+    for (const auto& enemy : enemies) {
+        if (enemy.alive) {
+            aliveEnemies++;
+        }
+    }
+    char stats[128];
+    int length = std::snprintf(stats, sizeof(stats), "FPS: X | Enemies: %d | Bullets Fired: %d | Active Bullets: %d | Q%d",
+                               aliveEnemies, bulletsFired, activeBullets, qualityLevel);
+    
+    // Shorter labels when the line would run into the mini-map, and what
+    // still does not fit stops a column short of its border
+    int room = miniMapLeft(fb) - 1;
+    if (length > room) {
+        length = std::snprintf(stats, sizeof(stats), "FPS: X | Enemies: %d | Fired: %d | Active: %d | Q%d",
+                               aliveEnemies, bulletsFired, activeBullets, qualityLevel);
+    }
+    
+    for (int i = 0; i < length && i < (int)sizeof(stats) - 1 && i < room; i++) {
+        fb.at(i, 0) = stats[i];
+    }
+}
+
+// Function to get the state the HUD would be drawn from now
+static HudState currentHudState(const FrameBuffer& fb) {
+    HudState state;
+    state.width = fb.width;
+    state.height = fb.height;
+    state.enemies = 0;
+    for (const auto& enemy : enemies) {
+        if (enemy.alive) state.enemies++;
+    }
+    state.fired = bulletsFired;
+    state.active = activeBullets;
+    state.quality = qualityLevel;
+    state.room = miniMapLeft(fb) - 1;
+    return state;
+}
+
+// Function to compare two HUD states
+static bool sameHudState(const HudState& a, const HudState& b) {
+    return a.width == b.width && a.height == b.height && a.enemies == b.enemies &&
+           a.fired == b.fired && a.active == b.active && a.quality == b.quality && a.room == b.room;
+}
+
+// Function to rasterize an overlay into its own layer and find the cells it covers
+static void rasterizeOverlay(OverlayLayer& layer, int width, int height, void (*draw)(FrameBuffer&)) {
+    layer.raster.resize(width, height);
+    std::fill(layer.raster.cells.begin(), layer.raster.cells.end(), '\0');
+    draw(layer.raster);
+    
+    layer.coverage.reset(height);
+    for (int y = 0; y < height; y++) {
+        const char* row = layer.raster.row(y);
+        int x0 = 0;
+        while (x0 < width && row[x0] == '\0') x0++;
+        int x1 = width;
+        while (x1 > x0 && row[x1 - 1] == '\0') x1--;
+        if (x0 < x1) layer.coverage.add(x0, y, x1, y + 1);
+    }
+    layer.valid = true;
+}
+
+// Function to copy an overlay's cells into the frame wherever they fall in a region
+static void blitOverlay(const OverlayLayer& layer, FrameBuffer& fb, const DirtySpans& region) {
+    for (int y = 0; y < fb.height; y++) {
+        int x0 = std::max(layer.coverage.begin[y], region.begin[y]);
+        int x1 = std::min(layer.coverage.end[y], region.end[y]);
+        const char* src = layer.raster.row(y);
+        char* dst = fb.row(y);
+        for (int x = x0; x < x1; x++) {
+            if (src[x] != '\0') dst[x] = src[x];
+        }
+    }
+}
+
+// Frame size the caches of every quality level were last sized for
+static int cachedWidth = 0, cachedHeight = 0;
+
+// Function to size the caches of every quality level's render paths for a
+// new frame size, so that switching levels later does not allocate
+static void sizeFrameCaches(int width, int height) {
+    if (width == cachedWidth && height == cachedHeight) return;
+    cachedWidth = width;
+    cachedHeight = height;
+    columnTablesFor(width);
+    rowDistancesFor(height);
+    sizeAngularCache(width);
+    columnCeilings.resize(width);
+    ditherRows.resize(3 * ((width + 3) & ~3));
+    floorRowGlyphs.resize(height * 4);
+    prepareTexturedColumns(height);
+}
+
+// Function to render the whole scene into the framebuffer
+void renderScene(FrameBuffer& fb) {
+    if (fb.width <= 0 || fb.height <= 0) return;
+    sizeFrameCaches(fb.width, fb.height);
+    
+    gbuffer.columns.resize(fb.width);
+    ColumnHit* hits = &gbuffer.columns[0];
+    
+    DirtySpans& region = composeRegion;
+    region.reset(fb.height);
+    
+    // Overlays are only rasterized again when what they show changed; the
+    // cells they covered before and cover now both need composing
+    MiniMapState miniMap = miniMapState(fb);
+    HudState hud = currentHudState(fb);
+    {
+        StageTimer timer(STAGE_OVERLAY);
+        if (!miniMapLayer.valid || !sameMiniMapState(miniMap, miniMapLayerState)) {
+            if (miniMapLayer.valid) region.add(miniMapLayer.coverage);
+            rasterizeOverlay(miniMapLayer, fb.width, fb.height, drawMiniMap);
+            region.add(miniMapLayer.coverage);
+            miniMapLayerState = miniMap;
+        }
+        if (!hudLayer.valid || !sameHudState(hud, hudLayerState)) {
+            if (hudLayer.valid) region.add(hudLayer.coverage);
+            rasterizeOverlay(hudLayer, fb.width, fb.height, drawHud);
+            region.add(hudLayer.coverage);
+            hudLayerState = hud;
+        }
+    }
+    
+    // Nothing the walls depend on changed: put back the last frame's static
+    // layer and only redraw sprites and overlays on top. If this framebuffer
+    // still holds the last frame, only the cells sprites or changed overlays
+    // covered need the static layer back.
+    StaticLayerKey key = currentStaticLayerKey(fb);
+    if (temporalReuse && staticLayerValid && sameStaticLayer(key, staticLayerKey)) {
+        StageTimer timer(STAGE_WALLS);
+        if (composedTarget != &fb || fb.serial != composedSerial) region.add(0, 0, fb.width, fb.height);
+        region.add(spriteDamage);
+        for (int y = 0; y < fb.height; y++) {
+            if (region.clean(y)) continue;
+            std::copy(staticLayer.row(y) + region.begin[y], staticLayer.row(y) + region.end[y], fb.row(y) + region.begin[y]);
+        }
+        fb.dirty.add(region);
+    } else {
+        // Ray casting for 3D walls
+        {
+            StageTimer timer(STAGE_RAYCAST);
+            castRays(fb.width, hits);
+        }
+        {
+            StageTimer timer(STAGE_WALLS);
+            drawWalls(fb, hits);
+        }
+        {
+            StageTimer timer(STAGE_FLOOR);
+            drawFloor(fb, hits);
+        }
+        region.add(0, 0, fb.width, fb.height);
+        fb.markDirty(0, 0, fb.width, fb.height);
+        
+        if (temporalReuse) {
+            staticLayer.resize(fb.width, fb.height);
+            std::copy(fb.cells.begin(), fb.cells.end(), staticLayer.cells.begin());
+            staticLayerKey = key;
+            staticLayerValid = true;
+        }
+    }
+    
+    // Sprite IDs go back to clear wherever sprites drew last frame
+    spriteIdsFor(fb);
+    clearSpriteIds(spriteDamage);
+    spriteDamage.reset(fb.height);
+    composedTarget = &fb;
+    fb.serial = ++composedSerial;
+    
+    // Sprites and overlays, bullets last so they appear on top of everything
+    // else; overlays go back over whatever was composed below them
+    {
+        StageTimer timer(STAGE_SPRITES);
+        drawEnemies(fb);
+        drawPlayers(fb);
+        region.add(spriteDamage);
+    }
+    {
+        StageTimer timer(STAGE_OVERLAY);
+        blitOverlay(miniMapLayer, fb, region);
+    }
+    {
+        StageTimer timer(STAGE_SPRITES);
+        drawBullets(fb);
+        region.add(spriteDamage);
+    }
+    
+    // Draw HUD
+    {
+        StageTimer timer(STAGE_OVERLAY);
+        blitOverlay(hudLayer, fb, region);
+    }
+}
+
+// Function to get the G-buffer of the last frame renderScene drew
+const GBuffer& frameGBuffer() {
+    return gbuffer;
+}
+
+// Function to look up what a cell of the last frame shows
+CellPick pickCell(int x, int y) {
+    const GBuffer& g = gbuffer;
+    CellPick pick;
+    pick.hit = g.columns[x];
+    
+    // The same span the wall pass drew for this column
+    int ceiling, floor;
+    wallSpan(pick.hit.depth, g.height, ceiling, floor);
+    if (y < ceiling) pick.surface = PICK_CEILING;
+    else if (y > floor) pick.surface = PICK_FLOOR;
+    else pick.surface = pick.hit.cell >= 0 ? PICK_WALL : PICK_NONE;
+    
+    int id = g.sprites[y * g.width + x];
+    pick.enemy = id > 0 && id < PLAYER_SPRITE_BASE ? id - 1 : -1;
+    pick.player = id >= PLAYER_SPRITE_BASE ? id - PLAYER_SPRITE_BASE : -1;
+    pick.bullet = id < 0 ? -id - 1 : -1;
+    return pick;
+}
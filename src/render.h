@@ -0,0 +1,187 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <algorithm>
+#include <vector>
+
+// Columns [begin, end) touched in each row; a row with begin >= end is clean.
+// One span per row keeps the bookkeeping fixed-size, at the price of also
+// covering the gap between two separate changes in a row.
+struct DirtySpans {
+    std::vector<int> begin;
+    std::vector<int> end;
+    
+    // Function to size the spans for a frame height and mark every row clean
+    void reset(int height) {
+        begin.assign(height, 1 << 30);
+        end.assign(height, 0);
+    }
+    
+    // Function to add a rectangle of cells, x1 and y1 exclusive
+    void add(int x0, int y0, int x1, int y1) {
+        y0 = std::max(y0, 0);
+        y1 = std::min(y1, (int)begin.size());
+        for (int y = y0; y < y1; y++) {
+            begin[y] = std::min(begin[y], x0);
+            end[y] = std::max(end[y], x1);
+        }
+    }
+    
+    // Function to add every span of another set
+    void add(const DirtySpans& other) {
+        int rows = std::min(begin.size(), other.begin.size());
+        for (int y = 0; y < rows; y++) {
+            begin[y] = std::min(begin[y], other.begin[y]);
+            end[y] = std::max(end[y], other.end[y]);
+        }
+    }
+    
+    bool clean(int y) const { return begin[y] >= end[y]; }
+};
+
+// Character framebuffer the renderer draws into
+struct FrameBuffer {
+    int width;
+    int height;
+    std::vector<char> cells;
+    DirtySpans dirty;     // Cells that may differ from the last presented frame
+    unsigned long serial; // Set by each renderScene call that draws into it
+    
+    FrameBuffer() : width(0), height(0), serial(0) {}
+    
+    // Resize the buffer, keeping its storage when the size is unchanged
+    void resize(int w, int h) {
+        if (w == width && h == height) return;
+        width = w;
+        height = h;
+        cells.assign(w * h, ' ');
+        dirty.reset(h);
+        dirty.add(0, 0, w, h);
+    }
+    
+    // Function to note that a rectangle of cells changed, x1 and y1 exclusive
+    void markDirty(int x0, int y0, int x1, int y1) { dirty.add(x0, y0, x1, y1); }
+    
+    char* row(int y) { return &cells[y * width]; }
+    const char* row(int y) const { return &cells[y * width]; }
+    
+    char& at(int x, int y) { return cells[y * width + x]; }
+    char at(int x, int y) const { return cells[y * width + x]; }
+};
+
+// Result of casting the ray for one screen column
+struct ColumnHit {
+    float depth; // Perpendicular distance to the wall, in front of the camera
+    int cell;    // Map index of the wall cell hit, -1 when the ray found no wall
+    int side;    // Face of the cell that was hit: 0 = crossed along x, 1 = along y
+    float u;     // Where along that face the ray landed, 0 to 1
+};
+
+// Sprite IDs kept per cell: 0 where no sprite was drawn, enemy i as i + 1,
+// remote player p as PLAYER_SPRITE_BASE + p and bullet b (or a point of its
+// trail) as -(b + 1)
+const int SPRITE_NONE = 0;
+const int PLAYER_SPRITE_BASE = 1 << 24;
+inline int enemySpriteId(int enemy) { return enemy + 1; }
+inline int playerSpriteId(int player) { return PLAYER_SPRITE_BASE + player; }
+inline int bulletSpriteId(int bullet) { return -(bullet + 1); }
+
+// What the last rendered frame shows, kept so other systems can ask what is
+// under a screen cell instead of casting rays of their own
+struct GBuffer {
+    int width;
+    int height;
+    std::vector<ColumnHit> columns; // Ray result of every column
+    std::vector<int> sprites;       // Sprite ID of every cell, the last sprite drawn over it
+    
+    GBuffer() : width(0), height(0) {}
+};
+
+// Scene surface a cell shows beneath any sprite
+enum PickSurface {
+    PICK_NONE,    // Open space, no wall within the view distance
+    PICK_CEILING,
+    PICK_WALL,
+    PICK_FLOOR
+};
+
+// Result of looking up one screen cell in the G-buffer
+struct CellPick {
+    PickSurface surface;
+    ColumnHit hit; // Ray result of the cell's column
+    int enemy;     // Index into enemies of the enemy drawn there, -1 for none
+    int player;    // Index into remotePlayers of the player drawn there, -1 for none
+    int bullet;    // Index into bullets of the bullet or trail drawn there, -1 for none
+};
+
+// columnStep value that picks the step from the framebuffer width
+const int COLUMN_STEP_ADAPTIVE = 0;
+
+// Most rays the adaptive column step casts per frame
+const int ADAPTIVE_COLUMN_RAYS = 160;
+
+// Detail knobs the frame-budget governor turns down when frames run long
+struct RenderQuality {
+    int columnStep;      // Cast one ray every columnStep columns, or COLUMN_STEP_ADAPTIVE
+    int refineSpan;      // Edge-adaptive casting: initial ray spacing, 0 casts every column
+    bool angularCache;   // Reuse rays by absolute angle while the camera only turns
+    float viewDistance;  // Rays give up after this many cells
+    bool texturedWalls;  // Draw wall textures instead of one glyph per column
+    bool castFloors;     // Perspective floor and ceiling instead of shading the floor by row
+    bool dither;         // Ordered dithering between shades instead of rounding to the nearest
+    int colorDepth;      // 2 = bold and blinking colors, 1 = plain colors, 0 = monochrome
+    int spriteDetail;    // 2 = full bullet pattern, 1 = reduced, 0 = centre only
+    int trailLength;     // Bullet trail points to draw
+};
+
+// Settings the renderer and encoder currently use, full detail by default
+extern RenderQuality renderQuality;
+
+// Quality level the current settings belong to, shown in the HUD
+extern int qualityLevel;
+
+// Reuse the walls, floor and ceiling of the previous frame while the camera,
+// the map and the settings they depend on are unchanged
+extern bool temporalReuse;
+
+// Function to work out how many columns apart rays are cast at a width
+int columnStepFor(int width);
+
+// Function to cast the rays for every screen column, reconstructing the
+// columns between rays when the column step is above one or refinement is
+// on; returns the number of rays actually cast
+int castRays(int width, ColumnHit* hits);
+
+// Function to draw the ceiling and wall slice of every column
+void drawWalls(FrameBuffer& fb, const ColumnHit* hits);
+
+// Function to shade the floor below every wall slice, and the ceiling above
+// them when floor casting is on
+void drawFloor(FrameBuffer& fb, const ColumnHit* hits);
+
+// Function to draw enemies
+void drawEnemies(FrameBuffer& fb);
+
+// Function to draw the other players of a network game
+void drawPlayers(FrameBuffer& fb);
+
+// Function to draw bullets and their trails
+void drawBullets(FrameBuffer& fb);
+
+// Function to draw the crosshair and stats line
+void drawHud(FrameBuffer& fb);
+
+// Function to get the G-buffer of the last frame renderScene drew
+const GBuffer& frameGBuffer();
+
+// Function to look up what a cell of the last frame shows, in constant
+// time; x and y must lie inside that frame. Overlays are not included.
+CellPick pickCell(int x, int y);
+
+// Function to render the whole scene into the framebuffer and mark the
+// cells that changed dirty. When the static layer is reused, only the cells
+// sprites covered last frame are restored, so nothing else may write into
+// the framebuffer between two calls.
+void renderScene(FrameBuffer& fb);
+
+#endif // RENDER_H
@@ -0,0 +1,57 @@
+#include "replay.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Function to load a replay file, returns false if it cannot be read
+bool loadReplay(const std::string& path, Replay& replay, std::string& error) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        error = "cannot open replay " + path;
+        return false;
+    }
+    
+    replay.frames.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        
+        // Strip whitespace and comments
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::string keys;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r') keys += line[i];
+        }
+        if (keys.empty()) continue;
+        
+        // Optional repeat count
+        int repeat = 1;
+        size_t star = keys.find('*');
+        if (star != std::string::npos) {
+            repeat = std::atoi(keys.substr(0, star).c_str());
+            keys.erase(0, star + 1);
+            if (repeat <= 0) {
+                std::ostringstream ss;
+                ss << path << ":" << lineNumber << ": bad repeat count";
+                error = ss.str();
+                return false;
+            }
+        }
+        
+        // '.' is an empty frame, '_' stands for the space bar
+        std::string frame;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == '.') continue;
+            frame += keys[i] == '_' ? ' ' : keys[i];
+        }
+        
+        for (int i = 0; i < repeat; i++) {
+            replay.frames.push_back(frame);
+        }
+    }
+    
+    return true;
+}
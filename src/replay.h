@@ -0,0 +1,21 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string>
+#include <vector>
+
+// A canned input recording: the keys pressed on each frame.
+//
+// File format, one frame per line:
+//   wq        keys pressed during the frame (w/a/s/d/q/e, '_' for space)
+//   30*w      the same keys repeated for 30 frames
+//   .         a frame without input
+//   # ...     comment
+struct Replay {
+    std::vector<std::string> frames;
+};
+
+// Function to load a replay file, returns false if it cannot be read
+bool loadReplay(const std::string& path, Replay& replay, std::string& error);
+
+#endif // REPLAY_H
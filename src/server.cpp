@@ -0,0 +1,284 @@
+#include "server.h"
+#include "profile.h"
+#include "trace.h"
+
+#include <algorithm>
+
+// Input commands one client may apply per tick; more than the tick rate's
+// worth would let a client move faster by sending faster
+const int MAX_COMMANDS_PER_TICK = 2;
+
+// Function to place a new player on an open cell, spreading slots over the map
+static void spawnPoint(int slot, float& x, float& y) {
+    int open = (int)std::count(map.begin(), map.end(), '.');
+    int pick = open > 0 ? (slot * 37 + 17) % open : 0;
+    for (int i = 0; i < mapWidth * mapHeight; i++) {
+        if (map[i] != '.') continue;
+        if (pick-- == 0) {
+            x = i % mapWidth + 0.5f;
+            y = i / mapWidth + 0.5f;
+            return;
+        }
+    }
+    x = mapWidth / 2.0f;
+    y = mapHeight / 2.0f;
+}
+
+// Function to make a client's player the one the game functions act on
+static void bindPlayer(ServerClient& c) {
+    playerX = c.x;
+    playerY = c.y;
+    playerA = c.a;
+    bullets.swap(c.bullets);
+    activeBullets = c.activeBullets;
+    bulletsFired = c.bulletsFired;
+}
+
+// Function to take the player's state back after the game functions ran
+static void unbindPlayer(ServerClient& c) {
+    c.x = playerX;
+    c.y = playerY;
+    c.a = playerA;
+    bullets.swap(c.bullets);
+    c.activeBullets = activeBullets;
+    c.bulletsFired = bulletsFired;
+}
+
+// Function to find the slot of a client address, -1 for strangers
+static int findClient(const GameServer& server, const NetAddress& address) {
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        if (server.clients[i].connected && server.clients[i].address == address) return (int)i;
+    }
+    return -1;
+}
+
+static void sendWelcome(GameServer& server, int slot) {
+    beginPacket(server.out, PACKET_WELCOME);
+    server.out.u8(slot);
+    server.out.u32(server.tick);
+    sendPacket(server.socket, server.clients[slot].address, &server.out.data[0], server.out.size());
+}
+
+// Function to give a new client a slot, or repeat the welcome it missed
+static void handleConnect(GameServer& server, const NetAddress& from) {
+    int slot = findClient(server, from);
+    if (slot < 0) {
+        for (size_t i = 0; i < server.clients.size() && slot < 0; i++) {
+            if (!server.clients[i].connected) slot = (int)i;
+        }
+        if (slot < 0) {
+            beginPacket(server.out, PACKET_REJECT);
+            sendPacket(server.socket, from, &server.out.data[0], server.out.size());
+            return;
+        }
+        
+        ServerClient& c = server.clients[slot];
+        c = ServerClient();
+        c.connected = true;
+        c.address = from;
+        c.lastHeard = server.tick;
+        spawnPoint(slot, c.x, c.y);
+        c.bullets.assign(MAX_BULLETS, Bullet());
+        server.clientCount++;
+    }
+    sendWelcome(server, slot);
+}
+
+// Function to apply the commands of an input packet the server has not seen yet
+static void handleInput(GameServer& server, ServerClient& c, PacketReader& r) {
+    unsigned int ackTick = r.u32();
+    unsigned int newest = r.u32();
+    int count = std::min((int)r.u8(), NET_INPUT_REDUNDANCY);
+    InputCommand commands[NET_INPUT_REDUNDANCY];
+    for (int i = 0; i < count; i++) {
+        commands[i] = (InputCommand)r.u8();
+    }
+    if (!r.ok) return;
+    
+    if (ackTick > c.ackedTick && ackTick <= server.tick) c.ackedTick = ackTick;
+    
+    // Oldest command first; anything older than the packet carries is lost
+    unsigned int first = std::max(c.lastInput + 1, newest >= (unsigned int)count ? newest - count + 1 : 1u);
+    if (first > newest || c.commandBudget <= 0) return;
+    unsigned int last = std::min(newest, first + c.commandBudget - 1);
+    bindPlayer(c);
+    for (unsigned int seq = first; seq <= last; seq++) {
+        applyInput(commands[newest - seq], NET_TICK_SECONDS);
+    }
+    unbindPlayer(c);
+    c.commandBudget -= (int)(last - first + 1);
+    c.lastInput = last;
+}
+
+// Function to read every waiting packet
+static void receiveAll(GameServer& server) {
+    NetAddress from;
+    int size;
+    while ((size = receivePacket(server.socket, from, &server.in[0], (int)server.in.size())) >= 0) {
+        PacketReader r(&server.in[0], size);
+        int type = readPacketType(r);
+        if (type == PACKET_CONNECT) {
+            handleConnect(server, from);
+            continue;
+        }
+        
+        int slot = findClient(server, from);
+        if (slot < 0) continue;
+        ServerClient& c = server.clients[slot];
+        c.lastHeard = server.tick;
+        if (type == PACKET_INPUT) {
+            handleInput(server, c, r);
+        } else if (type == PACKET_DISCONNECT) {
+            c.connected = false;
+            server.clientCount--;
+        }
+    }
+}
+
+// Function to record this tick's world: players, their bullets, live enemies
+static void captureWorld(GameServer& server) {
+    Snapshot& s = server.history.slotFor(server.tick);
+    s.tick = server.tick;
+    s.entities.clear();
+    
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        const ServerClient& c = server.clients[i];
+        if (!c.connected) continue;
+        EntityState e = { playerEntityId((int)i), ENTITY_PLAYER, quantizePosition(c.x), quantizePosition(c.y), quantizeAngle(c.a) };
+        s.entities.push_back(e);
+    }
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        const ServerClient& c = server.clients[i];
+        if (!c.connected) continue;
+        for (int b = 0; b < (int)c.bullets.size(); b++) {
+            const Bullet& bullet = c.bullets[b];
+            if (!bullet.active) continue;
+            EntityState e = { bulletEntityId((int)i, b), ENTITY_BULLET, quantizePosition(bullet.x), quantizePosition(bullet.y),
+                              quantizeAngle(std::atan2(bullet.dx, bullet.dy)) };
+            s.entities.push_back(e);
+        }
+    }
+    for (size_t i = 0; i < enemies.size(); i++) {
+        if (!enemies[i].alive) continue;
+        EntityState e = { enemyEntityId((int)i), ENTITY_ENEMY, quantizePosition(enemies[i].x), quantizePosition(enemies[i].y), 0 };
+        s.entities.push_back(e);
+    }
+}
+
+// Function to get this tick's snapshot body against a baseline, encoding it
+// the first time a client acked at that tick asks
+static const EncodedDelta& encodedFor(GameServer& server, const Snapshot* base, const Snapshot& current) {
+    unsigned int baseTick = base ? base->tick : 0;
+    for (size_t i = 0; i < server.encoded.size(); i++) {
+        if (server.encoded[i].baseTick == baseTick) return server.encoded[i];
+    }
+    EncodedDelta body;
+    body.baseTick = baseTick;
+    body.offset = server.bodies.size();
+    encodeSnapshotDelta(base, current, server.bodies);
+    body.size = server.bodies.size() - body.offset;
+    server.encoded.push_back(body);
+    server.stats.encodes++;
+    return server.encoded.back();
+}
+
+// Function to send every client its view of the world, or the whole world,
+// as a delta against what it acknowledged
+static void sendSnapshots(GameServer& server) {
+    const Snapshot& current = *server.history.find(server.tick);
+    server.encoded.clear();
+    server.bodies.clear();
+    if (server.interest) indexInterest(server.grid, current);
+    
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        ServerClient& c = server.clients[i];
+        if (!c.connected) continue;
+        
+        const Snapshot* base;
+        PacketWriter& out = server.out;
+        beginPacket(out, PACKET_SNAPSHOT);
+        out.u32(server.tick);
+        if (server.interest) {
+            const Snapshot& view = chooseView(server.grid, c.interest, playerEntityId((int)i), server.tick, c.ackedTick,
+                                              server.snapshotBudget, server.stats.interest);
+            base = c.interest.views.find(c.ackedTick);
+            out.u32(base ? base->tick : 0);
+            out.u32(c.lastInput);
+            encodeSnapshotDelta(base, view, out);
+            server.stats.encodes++;
+        } else {
+            base = server.history.find(c.ackedTick);
+            const EncodedDelta& body = encodedFor(server, base, current);
+            out.u32(body.baseTick);
+            out.u32(c.lastInput);
+            out.bytes(&server.bodies.data[body.offset], body.size);
+        }
+        if (sendPacket(server.socket, c.address, &out.data[0], out.size())) {
+            c.bytesSent += out.size();
+            server.stats.snapshotBytes += out.size();
+            server.stats.snapshots++;
+            if (!base) server.stats.fullSnapshots++;
+        }
+    }
+}
+
+// Function to load the world and open the server socket on a port
+bool startServer(GameServer& server, unsigned short port, std::string& error) {
+    initWorld();
+    debugOutput = false;
+    
+    if (!openUdp(server.socket, port, error)) return false;
+    server.tick = 0;
+    server.clients.assign(NET_MAX_CLIENTS, ServerClient());
+    server.clientCount = 0;
+    server.history.clear();
+    server.in.resize(NET_MAX_PACKET);
+    server.stats = ServerStats();
+    return true;
+}
+
+// Function to run one tick
+void serverTick(GameServer& server) {
+    TraceScope scope("server.tick");
+    double start = nowMs();
+    server.tick++;
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        server.clients[i].commandBudget = MAX_COMMANDS_PER_TICK;
+    }
+    
+    receiveAll(server);
+    
+    // Bullets fly and hit enemies one player at a time
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        ServerClient& c = server.clients[i];
+        if (!c.connected) continue;
+        if (server.tick - c.lastHeard > (unsigned int)CLIENT_TIMEOUT_TICKS) {
+            c.connected = false;
+            server.clientCount--;
+            continue;
+        }
+        if (c.activeBullets == 0) continue;
+        bindPlayer(c);
+        updateBullets(NET_TICK_SECONDS);
+        unbindPlayer(c);
+    }
+    
+    captureWorld(server);
+    sendSnapshots(server);
+    
+    server.stats.ticks++;
+    server.stats.tickMs += nowMs() - start;
+}
+
+// Function to tell every client the server is going away and close the socket
+void stopServer(GameServer& server) {
+    beginPacket(server.out, PACKET_DISCONNECT);
+    for (size_t i = 0; i < server.clients.size(); i++) {
+        if (server.clients[i].connected) {
+            sendPacket(server.socket, server.clients[i].address, &server.out.data[0], server.out.size());
+            server.clients[i].connected = false;
+        }
+    }
+    server.clientCount = 0;
+    closeUdp(server.socket);
+}
@@ -0,0 +1,90 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "game.h"
+#include "interest.h"
+#include "net.h"
+#include "snapshot.h"
+
+#include <string>
+#include <vector>
+
+// Ticks without a packet after which a client is dropped
+const int CLIENT_TIMEOUT_TICKS = NET_TICK_RATE * 5;
+
+// One connected player. Its position and bullets live here and are swapped
+// into the game's globals while the game functions move them.
+struct ServerClient {
+    bool connected;
+    NetAddress address;
+    float x, y, a;
+    std::vector<Bullet> bullets;
+    int activeBullets;
+    int bulletsFired;
+    unsigned int lastInput;  // Sequence number of the newest input command applied
+    int commandBudget;       // Input commands it may still apply this tick
+    unsigned int ackedTick;  // Newest snapshot the client has confirmed, 0 for none
+    unsigned int lastHeard;  // Tick the last packet arrived in
+    unsigned long bytesSent; // Snapshot bytes sent to this client
+    ClientInterest interest; // What it was shown, with interest management
+    
+    ServerClient() : connected(false), x(0), y(0), a(0), activeBullets(0), bulletsFired(0),
+                     lastInput(0), commandBudget(0), ackedTick(0), lastHeard(0), bytesSent(0) {}
+};
+
+// Totals since the server started
+struct ServerStats {
+    unsigned long ticks;
+    double tickMs;               // Time spent in serverTick
+    unsigned long snapshotBytes;
+    unsigned long snapshots;
+    unsigned long fullSnapshots; // Sent without a baseline
+    unsigned long encodes;       // Snapshot bodies encoded: one per client, or per acked tick without interest management
+    InterestCounts interest;     // Entities per client per tick, summed
+    
+    ServerStats() : ticks(0), tickMs(0.0), snapshotBytes(0), snapshots(0), fullSnapshots(0), encodes(0) {}
+};
+
+// Snapshot body for one baseline, encoded once per tick
+struct EncodedDelta {
+    unsigned int baseTick;
+    int offset, size; // Into GameServer::bodies
+};
+
+// Authoritative server: owns the world, runs every player's input through
+// the game functions and sends each client the world as a delta against the
+// last snapshot it acknowledged. With interest management each client is
+// sent only the part of the world near it and in its sight, updated at a
+// rate that falls with distance and within a byte cap per tick, so a body
+// is encoded per client; without it every client gets the whole world and
+// clients acking the same tick share one body.
+struct GameServer {
+    UdpSocket socket;
+    unsigned int tick;
+    std::vector<ServerClient> clients; // One per slot
+    int clientCount;
+    SnapshotHistory history;           // World snapshots of the last ticks
+    std::vector<EncodedDelta> encoded; // Bodies encoded this tick
+    PacketWriter bodies;
+    PacketWriter out;
+    std::vector<unsigned char> in;
+    bool interest;                     // Interest management on, set before the server starts
+    int snapshotBudget;                // Snapshot body bytes per client per tick, with interest management
+    InterestGrid grid;
+    ServerStats stats;
+    
+    GameServer() : tick(0), clientCount(0), interest(true), snapshotBudget(SNAPSHOT_BUDGET_BYTES) {}
+};
+
+// Function to load the world and open the server socket on a port (0 picks
+// a free one), returns false and sets error on failure
+bool startServer(GameServer& server, unsigned short port, std::string& error);
+
+// Function to run one tick: read client packets and apply their input,
+// advance bullets, record the world and send every client its snapshot
+void serverTick(GameServer& server);
+
+// Function to tell every client the server is going away and close the socket
+void stopServer(GameServer& server);
+
+#endif // SERVER_H
@@ -0,0 +1,96 @@
+#include "shading.h"
+#include "render.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char WALL_RAMP[SHADE_RAMP_SIZE + 1]    = "#MH%=~-;:,.     ";
+const char FLOOR_RAMP[SHADE_RAMP_SIZE + 1]   = "#%x:.,--        ";
+const char CEILING_RAMP[SHADE_RAMP_SIZE + 1] = "==--....        ";
+
+// 4x4 Bayer matrix, thresholds 0 to 15
+static const unsigned char BAYER[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+// Rounding to the nearest glyph, for the plain mode
+static const unsigned char HALF[4][4] = {
+    { 8, 8, 8, 8 },
+    { 8, 8, 8, 8 },
+    { 8, 8, 8, 8 },
+    { 8, 8, 8, 8 }
+};
+
+// Shades by distance in 1/SHADE_TABLE_STEPS cell steps, filled once at startup
+static const int SHADE_TABLE_STEPS = 16;
+static const int SHADE_TABLE_SIZE = 32 * SHADE_TABLE_STEPS;
+
+struct ShadeTables {
+    unsigned char wall[SHADE_TABLE_SIZE];
+    unsigned char floor[SHADE_TABLE_SIZE];
+    
+    ShadeTables();
+};
+
+// Function to interpolate the floor's ramp position between knots placed so
+// each old band's glyph sits in the middle of the distances it covered
+static float floorPosition(float distance) {
+    static const float KNOTS[][2] = {
+        { 2.0f, 0.0f }, { 8.0f / 3.0f, 1.0f }, { 4.0f, 3.0f }, { 8.0f, 5.0f }, { 20.0f, 7.0f }
+    };
+    static const int KNOT_COUNT = sizeof(KNOTS) / sizeof(KNOTS[0]);
+    
+    if (distance <= KNOTS[0][0]) return KNOTS[0][1];
+    for (int k = 1; k < KNOT_COUNT; k++) {
+        if (distance < KNOTS[k][0]) {
+            float t = (distance - KNOTS[k - 1][0]) / (KNOTS[k][0] - KNOTS[k - 1][0]);
+            return KNOTS[k - 1][1] + t * (KNOTS[k][1] - KNOTS[k - 1][1]);
+        }
+    }
+    return KNOTS[KNOT_COUNT - 1][1];
+}
+
+ShadeTables::ShadeTables() {
+    for (int q = 0; q < SHADE_TABLE_SIZE; q++) {
+        // Middle of the step, so a table entry stands for the distances around it
+        float distance = (q + 0.5f) / SHADE_TABLE_STEPS;
+        
+        // Walls: each doubling of the distance is one old band, and the old
+        // band's glyph is centred on it, '#' up close
+        if (distance >= 8.0f) {
+            wall[q] = WALL_SHADE_BLANK;
+        } else {
+            float position = std::max(0.0f, 2.0f * std::log2(distance) + 1.0f);
+            wall[q] = (unsigned char)std::min(position * SHADE_ONE, 7.0f * SHADE_ONE);
+        }
+        
+        floor[q] = distance >= 20.0f ? FLOOR_SHADE_BLANK : (unsigned char)(floorPosition(distance) * SHADE_ONE);
+    }
+}
+
+static const ShadeTables shadeTables;
+
+// Function to get the thresholds of the current dither mode
+const unsigned char (*ditherThresholds())[4] {
+    return renderQuality.dither ? BAYER : HALF;
+}
+
+// Function to look a distance up in one of the shade tables
+static inline int shadeLookup(const unsigned char* table, float distance) {
+    // Clamp before converting: the horizon row lies at an enormous distance
+    float step = std::min(std::max(distance * SHADE_TABLE_STEPS, 0.0f), (float)(SHADE_TABLE_SIZE - 1));
+    return table[(int)step];
+}
+
+// Function to get the shade of a wall at a distance
+int wallShade(float distance) {
+    return shadeLookup(shadeTables.wall, distance);
+}
+
+// Function to get the shade of the floor or ceiling at a distance
+int floorShade(float distance) {
+    return shadeLookup(shadeTables.floor, distance);
+}
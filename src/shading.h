@@ -0,0 +1,44 @@
+#ifndef SHADING_H
+#define SHADING_H
+
+// A shade is a position on a glyph ramp in steps of 1/SHADE_ONE glyph.
+// Ordered dithering adds the 4x4 Bayer threshold of the screen cell before
+// dropping the fraction, so a surface between two glyphs mixes them in a
+// fixed pattern instead of jumping from one to the next at a band edge.
+const int SHADE_ONE = 16;
+
+// Ramp positions one old shading band apart; the glyphs of the five bands
+// the renderer used before dithering sit at even positions
+const int SHADE_BAND = 2 * SHADE_ONE;
+
+// Ramps are padded with blanks so a shade, its threshold and a texture or
+// tile offset always land inside
+const int SHADE_RAMP_SIZE = 16;
+
+// Shades of walls and floors too far away to draw
+const int WALL_SHADE_BLANK = 11 * SHADE_ONE;
+const int FLOOR_SHADE_BLANK = 8 * SHADE_ONE;
+
+// Glyphs from the brightest to the faintest
+extern const char WALL_RAMP[SHADE_RAMP_SIZE + 1];
+extern const char FLOOR_RAMP[SHADE_RAMP_SIZE + 1];
+extern const char CEILING_RAMP[SHADE_RAMP_SIZE + 1];
+
+// Function to get the thresholds of the current dither mode, indexed by
+// [y & 3][x & 3]: the Bayer matrix, or one half everywhere, which rounds
+// every shade to the nearest glyph
+const unsigned char (*ditherThresholds())[4];
+
+// Function to get the shade of a wall at a distance; walls 8 or more cells
+// away are blank, as they were before
+int wallShade(float distance);
+
+// Function to get the shade of the floor or ceiling at a distance
+int floorShade(float distance);
+
+// Function to turn a shade and a cell's threshold into a glyph
+inline char shadeGlyph(const char* ramp, int shade, int threshold) {
+    return ramp[(shade + threshold) / SHADE_ONE];
+}
+
+#endif // SHADING_H
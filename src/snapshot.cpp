@@ -0,0 +1,158 @@
+#include "snapshot.h"
+
+#include <algorithm>
+
+// What an entity change carries
+enum DeltaBits {
+    DELTA_X = 1,
+    DELTA_Y = 2,
+    DELTA_ANGLE = 4,
+    DELTA_NEW = 8,     // Followed by the kind and every field in full
+    DELTA_REMOVED = 16 // Nothing follows
+};
+
+// Function to find an entity by ID, NULL when the snapshot has none
+const EntityState* findEntity(const Snapshot& snapshot, unsigned int id) {
+    const std::vector<EntityState>& e = snapshot.entities;
+    size_t lo = 0, hi = e.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (e[mid].id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < e.size() && e[lo].id == id ? &e[lo] : NULL;
+}
+
+// Function to get the smallest signed step from one 16-bit field value to another
+static inline int fieldDelta(unsigned short from, unsigned short to) {
+    return (short)(unsigned short)(to - from);
+}
+
+// Function to write the entities that changed from base to current
+void encodeSnapshotDelta(const Snapshot* base, const Snapshot& current, PacketWriter& w) {
+    static const std::vector<EntityState> none;
+    const std::vector<EntityState>& from = base ? base->entities : none;
+    const std::vector<EntityState>& to = current.entities;
+    
+    // The change count is patched in once it is known
+    int countAt = w.size();
+    w.u16(0);
+    unsigned int changes = 0;
+    unsigned int previousId = 0;
+    
+    size_t i = 0, j = 0;
+    while (i < from.size() || j < to.size()) {
+        bool removed = j == to.size() || (i < from.size() && from[i].id < to[j].id);
+        bool added = !removed && (i == from.size() || to[j].id < from[i].id);
+        if (removed) {
+            w.varint(from[i].id - previousId);
+            w.u8(DELTA_REMOVED);
+            previousId = from[i].id;
+            changes++;
+            i++;
+            continue;
+        }
+        
+        const EntityState& e = to[j];
+        if (added) {
+            w.varint(e.id - previousId);
+            w.u8(DELTA_NEW);
+            w.u8(e.kind);
+            w.u16(e.x);
+            w.u16(e.y);
+            w.u16(e.angle);
+            previousId = e.id;
+            changes++;
+            j++;
+            continue;
+        }
+        
+        // Present in both: only the fields that moved
+        const EntityState& b = from[i];
+        unsigned int mask = (e.x != b.x ? DELTA_X : 0) | (e.y != b.y ? DELTA_Y : 0) | (e.angle != b.angle ? DELTA_ANGLE : 0);
+        if (mask) {
+            w.varint(e.id - previousId);
+            w.u8(mask);
+            if (mask & DELTA_X) w.svarint(fieldDelta(b.x, e.x));
+            if (mask & DELTA_Y) w.svarint(fieldDelta(b.y, e.y));
+            if (mask & DELTA_ANGLE) w.svarint(fieldDelta(b.angle, e.angle));
+            previousId = e.id;
+            changes++;
+        }
+        i++;
+        j++;
+    }
+    
+    w.data[countAt] = (unsigned char)changes;
+    w.data[countAt + 1] = (unsigned char)(changes >> 8);
+}
+
+// Function to count the bytes of a value written as a varint
+static inline int varintBytes(unsigned int v) {
+    int n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static inline int svarintBytes(int v) {
+    return varintBytes(((unsigned int)v << 1) ^ (unsigned int)(v >> 31));
+}
+
+// Function to count the bytes encodeSnapshotDelta spends on one entity
+int entityDeltaBytes(const EntityState* base, const EntityState& e) {
+    const int ID_AND_MASK = 3;
+    if (!base) return ID_AND_MASK + 7;
+    int bytes = 0;
+    if (e.x != base->x) bytes += svarintBytes(fieldDelta(base->x, e.x));
+    if (e.y != base->y) bytes += svarintBytes(fieldDelta(base->y, e.y));
+    if (e.angle != base->angle) bytes += svarintBytes(fieldDelta(base->angle, e.angle));
+    return bytes > 0 ? ID_AND_MASK + bytes : 0;
+}
+
+// Function to rebuild a snapshot from its base and the changes
+bool decodeSnapshotDelta(const Snapshot* base, PacketReader& r, Snapshot& out) {
+    static const std::vector<EntityState> none;
+    const std::vector<EntityState>& from = base ? base->entities : none;
+    std::vector<EntityState>& to = out.entities;
+    to.clear();
+    
+    unsigned int changes = r.u16();
+    unsigned int id = 0;
+    size_t i = 0;
+    for (unsigned int c = 0; c < changes && r.ok; c++) {
+        id += r.varint();
+        unsigned int mask = r.u8();
+        
+        // Entities before this ID are unchanged
+        while (i < from.size() && from[i].id < id) to.push_back(from[i++]);
+        bool inBase = i < from.size() && from[i].id == id;
+        
+        if (mask & DELTA_REMOVED) {
+            if (!inBase) return false;
+            i++;
+            continue;
+        }
+        
+        EntityState e;
+        if (mask & DELTA_NEW) {
+            if (inBase) return false;
+            e.id = id;
+            e.kind = (unsigned char)r.u8();
+            e.x = (unsigned short)r.u16();
+            e.y = (unsigned short)r.u16();
+            e.angle = (unsigned short)r.u16();
+        } else {
+            if (!inBase) return false;
+            e = from[i++];
+            if (mask & DELTA_X) e.x = (unsigned short)(e.x + r.svarint());
+            if (mask & DELTA_Y) e.y = (unsigned short)(e.y + r.svarint());
+            if (mask & DELTA_ANGLE) e.angle = (unsigned short)(e.angle + r.svarint());
+        }
+        to.push_back(e);
+    }
+    while (i < from.size()) to.push_back(from[i++]);
+    return r.ok;
+}
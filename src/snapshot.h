@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game.h"
+#include "net.h"
+
+#include <cmath>
+#include <vector>
+
+// Kinds of entity a snapshot carries
+enum EntityKind {
+    ENTITY_PLAYER = 1,
+    ENTITY_ENEMY = 2,
+    ENTITY_BULLET = 3
+};
+
+// Most players one server holds
+const int NET_MAX_CLIENTS = 128;
+
+// Entity IDs: the players by slot, then every slot's bullets, then the
+// enemies by their index in the enemy list
+inline unsigned int playerEntityId(int slot) { return 1 + slot; }
+inline unsigned int bulletEntityId(int slot, int bullet) { return 1 + NET_MAX_CLIENTS + slot * MAX_BULLETS + bullet; }
+inline unsigned int enemyEntityId(int enemy) { return 1 + NET_MAX_CLIENTS * (1 + MAX_BULLETS) + enemy; }
+
+// Function to get the enemy index of an enemy entity ID
+inline int enemyOfEntity(unsigned int id) { return (int)(id - enemyEntityId(0)); }
+
+// Positions travel in 1/256 of a cell, which covers maps up to 256 cells
+// across; angles in 1/65536 of a turn
+const float POSITION_SCALE = 256.0f;
+const float ANGLE_SCALE = 65536.0f / 6.28318531f;
+
+// Function to quantize a map coordinate, clamped to the range a field holds
+inline unsigned short quantizePosition(float v) {
+    int q = (int)(v * POSITION_SCALE + 0.5f);
+    return (unsigned short)(q < 0 ? 0 : (q > 65535 ? 65535 : q));
+}
+
+inline float dequantizePosition(unsigned short q) {
+    return q / POSITION_SCALE;
+}
+
+// Function to quantize an angle; every angle wraps into the 16 bits
+inline unsigned short quantizeAngle(float a) {
+    return (unsigned short)((int)std::floor(a * ANGLE_SCALE + 0.5f) & 0xFFFF);
+}
+
+// Function to turn a quantized angle back into radians, between -pi and pi
+inline float dequantizeAngle(unsigned short q) {
+    return (short)q / ANGLE_SCALE;
+}
+
+// One entity as a snapshot carries it
+struct EntityState {
+    unsigned int id; // Stable for the entity's lifetime, never 0
+    unsigned char kind;
+    unsigned short x, y, angle;
+};
+
+// World state of one server tick, entities sorted by ID
+struct Snapshot {
+    unsigned int tick; // 0 for no snapshot
+    std::vector<EntityState> entities;
+    
+    Snapshot() : tick(0) {}
+};
+
+// Function to find an entity by ID, NULL when the snapshot has none
+const EntityState* findEntity(const Snapshot& snapshot, unsigned int id);
+
+// Function to write the entities that changed from base to current: for
+// each, the gap to the previous ID, a mask of what changed and the changed
+// fields as small signed differences. New entities are sent whole, removed
+// ones as their ID alone; a NULL base sends everything.
+void encodeSnapshotDelta(const Snapshot* base, const Snapshot& current, PacketWriter& w);
+
+// Function to count the bytes encodeSnapshotDelta spends on one entity
+// against its state in the base (NULL when the base lacks it), guessing two
+// for the ID gap; 0 when nothing changed
+int entityDeltaBytes(const EntityState* base, const EntityState& e);
+
+// Function to rebuild a snapshot from its base and the changes
+// encodeSnapshotDelta wrote, returns false on a malformed packet
+bool decodeSnapshotDelta(const Snapshot* base, PacketReader& r, Snapshot& out);
+
+// Snapshots of the last ticks, by tick number, to delta against
+const int SNAPSHOT_HISTORY = 32;
+
+struct SnapshotHistory {
+    Snapshot slots[SNAPSHOT_HISTORY];
+    
+    // Function to get the slot a tick is stored in, replacing the oldest
+    Snapshot& slotFor(unsigned int tick) { return slots[tick % SNAPSHOT_HISTORY]; }
+    
+    // Function to find the snapshot of a tick, NULL when it is gone
+    const Snapshot* find(unsigned int tick) const {
+        const Snapshot& s = slots[tick % SNAPSHOT_HISTORY];
+        return tick != 0 && s.tick == tick ? &s : NULL;
+    }
+    
+    void clear() {
+        for (int i = 0; i < SNAPSHOT_HISTORY; i++) slots[i].tick = 0;
+    }
+};
+
+#endif // SNAPSHOT_H
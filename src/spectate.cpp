@@ -0,0 +1,349 @@
+#include "spectate.h"
+#include "platform.h"
+#include "profile.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef PLATFORM_UNIX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef PLATFORM_UNIX
+
+// Telnet clients are told the server echoes and sends no go-aheads, which
+// puts them in character mode so keys typed do not scribble over the
+// picture; then the cursor is hidden. Netcat prints the telnet bytes, and
+// the first frame clears them away.
+static const char GREETING[] = "\xff\xfb\x01\xff\xfb\x03\033[?25l";
+
+// Sent to viewers still connected when the game ends
+static const char FAREWELL[] = "\033[0m\033[?25h\r\n";
+
+// Poll set of the viewers and their slots, sized for every slot up front
+static std::vector<pollfd> polls;
+static std::vector<int> pollSlots;
+
+// Function to get a chunk no viewer holds, held once by the caller. Chunks
+// are sized for the longest frame so far, rounded up to a power of two, so a
+// keyframe landing in one that last held a small diff does not have to grow
+// it and frames growing a little do not regrow every chunk.
+static SpectatorChunk* takeChunk(SpectatorServer& server) {
+    SpectatorChunk* chunk;
+    if (server.spare.empty()) {
+        chunk = new SpectatorChunk();
+        server.chunks.push_back(chunk);
+    } else {
+        chunk = server.spare.back();
+        server.spare.pop_back();
+    }
+    size_t capacity = 1024;
+    while (capacity < server.largestChunk) capacity *= 2;
+    chunk->data.reserve(capacity);
+    chunk->refs = 1;
+    return chunk;
+}
+
+// Function to let go of a chunk, returning it to the pool after the last holder
+static void releaseChunk(SpectatorServer& server, SpectatorChunk* chunk) {
+    if (--chunk->refs == 0 && chunk->pooled) server.spare.push_back(chunk);
+}
+
+static void queueChunk(Viewer& viewer, SpectatorChunk* chunk) {
+    viewer.queue[(viewer.head + viewer.count) % SPECTATOR_QUEUE_FRAMES] = chunk;
+    viewer.count++;
+    viewer.queuedBytes += chunk->data.size();
+    chunk->refs++;
+}
+
+// Function to throw away the frames a viewer has not started on; it needs a
+// keyframe before anything else makes sense. A frame already partly sent has
+// to be finished, or the next one would start inside an escape sequence.
+static void dropBacklog(SpectatorServer& server, Viewer& viewer) {
+    int keep = viewer.sentOfFirst > 0 ? 1 : 0;
+    for (int i = keep; i < viewer.count; i++) {
+        SpectatorChunk* chunk = viewer.queue[(viewer.head + i) % SPECTATOR_QUEUE_FRAMES];
+        viewer.queuedBytes -= chunk->data.size();
+        releaseChunk(server, chunk);
+    }
+    viewer.count = keep;
+    viewer.needsKeyframe = true;
+}
+
+// Function to disconnect a viewer and free its slot
+static void closeViewer(SpectatorServer& server, Viewer& viewer) {
+    viewer.sentOfFirst = 0;
+    dropBacklog(server, viewer);
+    close(viewer.fd);
+    viewer = Viewer();
+    server.viewerCount--;
+    server.stats.left++;
+}
+
+// Function to send without raising SIGPIPE when the viewer has gone
+static ssize_t sendVectors(int fd, iovec* iov, int count) {
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+    return sendmsg(fd, &message, MSG_NOSIGNAL);
+#else
+    return sendmsg(fd, &message, 0); // SO_NOSIGPIPE is set on the socket
+#endif
+}
+
+// Function to listen for viewers on a TCP port
+bool startSpectators(SpectatorServer& server, unsigned short port, std::string& error) {
+    server.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.listenFd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    int on = 1;
+    setsockopt(server.listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    int flags = fcntl(server.listenFd, F_GETFL, 0);
+    if (bind(server.listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server.listenFd, SOMAXCONN) < 0 ||
+        flags == -1 || fcntl(server.listenFd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        error = std::string("listen: ") + std::strerror(errno);
+        close(server.listenFd);
+        server.listenFd = -1;
+        return false;
+    }
+    
+    server.viewers.assign(SPECTATOR_MAX_VIEWERS, Viewer());
+    polls.reserve(SPECTATOR_MAX_VIEWERS);
+    pollSlots.reserve(SPECTATOR_MAX_VIEWERS);
+    server.viewerCount = 0;
+    server.largestChunk = 0;
+    server.shown = PresentedFrame();
+    // Every queue holds at most SPECTATOR_QUEUE_FRAMES frames and each frame
+    // brings a diff and perhaps a keyframe, so the pool does not grow past this
+    for (int i = 0; i < 2 * SPECTATOR_QUEUE_FRAMES + 2; i++) {
+        server.chunks.push_back(new SpectatorChunk());
+        server.spare.push_back(server.chunks.back());
+    }
+    server.greeting.data = GREETING;
+    server.greeting.pooled = false;
+    server.stats = SpectatorStats();
+    return true;
+}
+
+// Function to get the port the spectator server listens on
+unsigned short spectatorPort(const SpectatorServer& server) {
+    sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    if (getsockname(server.listenFd, (sockaddr*)&addr, &length) < 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+// Function to take every waiting connection; they start with the greeting
+// and wait for a keyframe
+static void acceptViewers(SpectatorServer& server) {
+    int fd;
+    while ((fd = accept(server.listenFd, NULL, NULL)) >= 0) {
+        Viewer* viewer = NULL;
+        for (size_t i = 0; i < server.viewers.size() && !viewer; i++) {
+            if (server.viewers[i].fd < 0) viewer = &server.viewers[i];
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (!viewer || flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            close(fd);
+            continue;
+        }
+        // Frames are written whole; waiting to fill a segment only adds latency
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        int buffer = SPECTATOR_SOCKET_BUFFER;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        
+        viewer->fd = fd;
+        viewer->needsKeyframe = true;
+        queueChunk(*viewer, &server.greeting);
+        server.viewerCount++;
+        server.stats.joined++;
+    }
+}
+
+// Function to throw away whatever viewers type and notice the ones that left
+static void readViewers(SpectatorServer& server) {
+    polls.clear();
+    pollSlots.clear();
+    for (size_t i = 0; i < server.viewers.size(); i++) {
+        if (server.viewers[i].fd < 0) continue;
+        pollfd p = { server.viewers[i].fd, POLLIN, 0 };
+        polls.push_back(p);
+        pollSlots.push_back((int)i);
+    }
+    if (polls.empty() || poll(&polls[0], polls.size(), 0) <= 0) return;
+    
+    char scratch[512];
+    for (size_t i = 0; i < polls.size(); i++) {
+        if (polls[i].revents == 0) continue;
+        Viewer& viewer = server.viewers[pollSlots[i]];
+        bool gone = (polls[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        ssize_t n = -1;
+        while (!gone && (n = recv(viewer.fd, scratch, sizeof(scratch), 0)) != 0) {
+            if (n < 0) {
+                gone = errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+                break;
+            }
+        }
+        if (gone || n == 0) closeViewer(server, viewer);
+    }
+}
+
+// Function to send a viewer as much of its queue as the socket takes, in one call
+static void flushViewer(SpectatorServer& server, Viewer& viewer) {
+    iovec iov[SPECTATOR_QUEUE_FRAMES];
+    for (int i = 0; i < viewer.count; i++) {
+        const std::string& data = viewer.queue[(viewer.head + i) % SPECTATOR_QUEUE_FRAMES]->data;
+        size_t offset = i == 0 ? viewer.sentOfFirst : 0;
+        iov[i].iov_base = (void*)(data.data() + offset);
+        iov[i].iov_len = data.size() - offset;
+    }
+    ssize_t sent = sendVectors(viewer.fd, iov, viewer.count);
+    server.stats.writes++;
+    if (sent < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) closeViewer(server, viewer);
+        return;
+    }
+    
+    viewer.bytesSent += sent;
+    viewer.queuedBytes -= sent;
+    server.stats.bytesSent += sent;
+    size_t left = sent;
+    while (left > 0) {
+        SpectatorChunk* chunk = viewer.queue[viewer.head];
+        size_t rest = chunk->data.size() - viewer.sentOfFirst;
+        if (left < rest) {
+            viewer.sentOfFirst += left;
+            break;
+        }
+        left -= rest;
+        viewer.sentOfFirst = 0;
+        viewer.head = (viewer.head + 1) % SPECTATOR_QUEUE_FRAMES;
+        viewer.count--;
+        releaseChunk(server, chunk);
+    }
+}
+
+// Function to take in new viewers, drop the ones that left, and queue and
+// send them a frame
+void broadcastFrame(SpectatorServer& server, const FrameBuffer& fb) {
+    if (server.listenFd < 0) return;
+    TraceScope scope("spectate.broadcast");
+    double start = nowMs();
+    server.stats.frames++;
+    acceptViewers(server);
+    readViewers(server);
+    if (server.viewerCount == 0) {
+        // Nobody has seen this frame; the next one starts over from a clear screen
+        server.shown.colorDepth = -1;
+        server.stats.broadcastMs += nowMs() - start;
+        return;
+    }
+    
+    // The changes since the last frame, encoded once for everyone in step.
+    // After a break the diff is the whole screen and doubles as the keyframe.
+    bool restart = server.shown.colorDepth == -1;
+    SpectatorChunk* delta = takeChunk(server);
+    encodeFrameDiff(fb, server.shown, delta->data);
+    server.largestChunk = std::max(server.largestChunk, delta->data.size());
+    
+    // Viewers that could not take the last frames start over from a keyframe
+    bool keyframeWanted = false;
+    for (size_t i = 0; i < server.viewers.size(); i++) {
+        Viewer& viewer = server.viewers[i];
+        if (viewer.fd < 0) continue;
+        if (!viewer.needsKeyframe && !delta->data.empty() &&
+            (viewer.count == SPECTATOR_QUEUE_FRAMES || viewer.queuedBytes + delta->data.size() > SPECTATOR_BACKLOG_BYTES)) {
+            dropBacklog(server, viewer);
+            server.stats.resyncs++;
+        }
+        keyframeWanted = keyframeWanted || viewer.needsKeyframe;
+    }
+    SpectatorChunk* keyframe = NULL;
+    if (keyframeWanted && restart) {
+        keyframe = delta;
+        keyframe->refs++;
+    } else if (keyframeWanted) {
+        keyframe = takeChunk(server);
+        server.keyShown.colorDepth = -1;
+        encodeFrameDiff(fb, server.keyShown, keyframe->data);
+        server.largestChunk = std::max(server.largestChunk, keyframe->data.size());
+        server.stats.keyframes++;
+    }
+    
+    for (size_t i = 0; i < server.viewers.size(); i++) {
+        Viewer& viewer = server.viewers[i];
+        if (viewer.fd < 0) continue;
+        if (viewer.needsKeyframe) {
+            if (viewer.count < SPECTATOR_QUEUE_FRAMES) {
+                queueChunk(viewer, keyframe);
+                viewer.needsKeyframe = false;
+            }
+        } else if (!delta->data.empty()) {
+            queueChunk(viewer, delta);
+        }
+        if (viewer.count > 0) flushViewer(server, viewer);
+    }
+    releaseChunk(server, delta);
+    if (keyframe) releaseChunk(server, keyframe);
+    server.stats.broadcastMs += nowMs() - start;
+}
+
+// Function to disconnect every viewer and stop listening
+void stopSpectators(SpectatorServer& server) {
+    for (size_t i = 0; i < server.viewers.size(); i++) {
+        Viewer& viewer = server.viewers[i];
+        if (viewer.fd < 0) continue;
+        iovec iov = { (void*)FAREWELL, sizeof(FAREWELL) - 1 };
+        sendVectors(viewer.fd, &iov, 1);
+        closeViewer(server, viewer);
+    }
+    if (server.listenFd >= 0) close(server.listenFd);
+    server.listenFd = -1;
+    for (size_t i = 0; i < server.chunks.size(); i++) {
+        delete server.chunks[i];
+    }
+    server.chunks.clear();
+    server.spare.clear();
+}
+
+#else
+
+// Spectating needs BSD sockets; the Windows build cannot be watched
+bool startSpectators(SpectatorServer& server, unsigned short, std::string& error) {
+    server.listenFd = -1;
+    error = "spectating is only available on Linux/Unix";
+    return false;
+}
+
+unsigned short spectatorPort(const SpectatorServer&) {
+    return 0;
+}
+
+void broadcastFrame(SpectatorServer&, const FrameBuffer&) {
+}
+
+void stopSpectators(SpectatorServer& server) {
+    server.listenFd = -1;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include "present.h"
+#include "render.h"
+
+#include <string>
+#include <vector>
+
+// Most viewers one game streams to
+const int SPECTATOR_MAX_VIEWERS = 1024;
+
+// Frames and bytes waiting for one viewer before it is given up on and sent
+// a keyframe once it catches up
+const int SPECTATOR_QUEUE_FRAMES = 32;
+const size_t SPECTATOR_BACKLOG_BYTES = 256 * 1024;
+
+// Kernel send buffer of a viewer socket. Left to grow on its own it takes
+// megabytes, seconds of frames a slow viewer would watch late.
+const int SPECTATOR_SOCKET_BUFFER = 64 * 1024;
+
+// One encoded frame, shared by every viewer it is queued for. It goes back
+// to the pool when the last of them has sent it.
+struct SpectatorChunk {
+    std::string data;
+    int refs;
+    bool pooled; // False for chunks that live as long as the server
+    
+    SpectatorChunk() : refs(0), pooled(true) {}
+};
+
+// One connected viewer and the frames it has not been sent yet
+struct Viewer {
+    int fd;                                         // -1 for a free slot
+    SpectatorChunk* queue[SPECTATOR_QUEUE_FRAMES];  // Ring, oldest at head
+    int head, count;
+    size_t sentOfFirst;                             // Bytes of the oldest chunk already sent
+    size_t queuedBytes;                             // Bytes still to send
+    bool needsKeyframe;                             // Joined, or fell too far behind
+    unsigned long bytesSent;
+    
+    Viewer() : fd(-1), head(0), count(0), sentOfFirst(0), queuedBytes(0), needsKeyframe(false), bytesSent(0) {}
+};
+
+// Totals since the spectator server started
+struct SpectatorStats {
+    unsigned long frames;    // Frames broadcast
+    unsigned long keyframes; // Full frames encoded for joining or lagging viewers
+    unsigned long joined;
+    unsigned long left;
+    unsigned long resyncs;   // Viewers that fell behind and were sent a keyframe
+    unsigned long bytesSent;
+    unsigned long writes;    // writev calls
+    double broadcastMs;      // Time spent in broadcastFrame
+    
+    SpectatorStats() : frames(0), keyframes(0), joined(0), left(0), resyncs(0), bytesSent(0), writes(0), broadcastMs(0.0) {}
+};
+
+// Streams the game's frames as ANSI output to any number of TCP viewers
+// (telnet or netcat). Each frame is diffed and encoded once against what
+// every viewer in step already shows, and the same buffer is queued for all
+// of them; a viewer that cannot keep up is skipped until its socket drains
+// and then gets a full frame.
+struct SpectatorServer {
+    int listenFd;
+    std::vector<Viewer> viewers;          // One per slot
+    int viewerCount;
+    PresentedFrame shown;                 // What a viewer in step shows
+    PresentedFrame keyShown;              // Scratch for encoding keyframes
+    std::vector<SpectatorChunk*> chunks;  // Every chunk the pool owns
+    std::vector<SpectatorChunk*> spare;   // Chunks no viewer holds
+    SpectatorChunk greeting;              // Sent once to every new viewer
+    size_t largestChunk;                  // Longest frame encoded, what every chunk is sized for
+    SpectatorStats stats;
+    
+    SpectatorServer() : listenFd(-1), viewerCount(0), largestChunk(0) {}
+};
+
+// Function to listen for viewers on a TCP port (0 picks a free one), returns
+// false and sets error on failure
+bool startSpectators(SpectatorServer& server, unsigned short port, std::string& error);
+
+// Function to get the port the spectator server listens on
+unsigned short spectatorPort(const SpectatorServer& server);
+
+// Function to take in new viewers, drop the ones that left, and queue and
+// send them a frame
+void broadcastFrame(SpectatorServer& server, const FrameBuffer& fb);
+
+// Function to disconnect every viewer and stop listening
+void stopSpectators(SpectatorServer& server);
+
+#endif // SPECTATE_H
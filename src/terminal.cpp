@@ -0,0 +1,73 @@
+#include "terminal.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#ifdef PLATFORM_UNIX
+// Terminal mode settings
+static struct termios orig_termios;
+
+// Function to initialize terminal for raw input
+void initTerminal() {
+    // Save original terminal settings
+    tcgetattr(STDIN_FILENO, &orig_termios);
+    
+    // Configure terminal for raw input
+    struct termios raw = orig_termios;
+    raw.c_lflag &= ~(ECHO | ICANON | ISIG); // Disable echo, canonical mode, and signals
+    raw.c_iflag &= ~(IXON | ICRNL);         // Disable software flow control and CR to NL
+    raw.c_oflag &= ~(OPOST);                // Disable output processing
+    raw.c_cc[VMIN] = 0;                     // Return immediately with whatever is available
+    raw.c_cc[VTIME] = 0;                    // No timeout
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    
+    // Set stdin to non-blocking
+    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
+    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    
+    // Hide cursor and clear screen
+    std::cout << "\033[?25l";
+    std::cout << "\033[2J\033[H";
+    
+    // Print debug message
+    std::cout << "\033[1;32mTerminal initialized for WSL2. Press SPACE to shoot.\033[0m" << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    std::cout << "\033[2J\033[H";
+}
+
+// Function to restore terminal settings
+void restoreTerminal() {
+    // Show cursor
+    std::cout << "\033[?25h";
+    
+    // Reset terminal
+    std::cout << "\033[0m";
+    std::cout << "\033[2J\033[H";
+    
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
+}
+
+// Function to check if a key is pressed
+bool isKeyPressed(char key) {
+    char c;
+    if (read(STDIN_FILENO, &c, 1) > 0) {
+        return c == key;
+    }
+    return false;
+}
+
+// Function to clear screen
+void clearScreen() {
+    // Clear screen and move cursor to home position
+    std::cout << "\033[2J\033[H";
+}
+
+// Function to get terminal size
+void getTerminalSize(int& width, int& height) {
+    struct winsize w;
+    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+    width = w.ws_col;
+    height = w.ws_row;
+}
+#endif
@@ -0,0 +1,24 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "platform.h"
+
+// Platform-specific keyboard input handling
+#ifdef PLATFORM_UNIX
+// Function to initialize terminal for raw input
+void initTerminal();
+
+// Function to restore terminal settings
+void restoreTerminal();
+
+// Function to check if a key is pressed
+bool isKeyPressed(char key);
+
+// Function to clear screen
+void clearScreen();
+
+// Function to get terminal size
+void getTerminalSize(int& width, int& height);
+#endif
+
+#endif // TERMINAL_H
@@ -0,0 +1,125 @@
+#include "textures.h"
+#include "shading.h"
+
+#include <algorithm>
+#include <vector>
+
+// Brightness levels of every texture, one string per texel row
+static const char* const TEXTURES[TEXTURE_COUNT][TEXTURE_SIZE] = {
+    // Brick
+    { "22212222",
+      "22212222",
+      "22212222",
+      "11111111",
+      "12222222",
+      "12222222",
+      "12222222",
+      "11111111" },
+    // Panels
+    { "22222222",
+      "21111112",
+      "21222212",
+      "21222212",
+      "21222212",
+      "21222212",
+      "21111112",
+      "22222222" },
+    // Rough stone
+    { "22122212",
+      "21222122",
+      "22220222",
+      "12222221",
+      "22122222",
+      "22221122",
+      "20222222",
+      "22222102" }
+};
+
+// Screen columns of textured wall, built the first time they are needed.
+// One entry per texture, texel column, dither phase and ceiling row, for one
+// screen height and dither mode.
+struct ColumnCache {
+    int height;
+    int minCeiling;
+    int ceilingCount;
+    const unsigned char (*thresholds)[4];
+    std::vector<char> glyphs;
+    std::vector<unsigned char> filled;
+    
+    ColumnCache() : height(0), minCeiling(0), ceilingCount(0), thresholds(NULL) {}
+};
+
+// Columns of the dither threshold table
+static const int DITHER_PHASES = 4;
+
+static ColumnCache columnCache;
+
+// Function to pick the texture of a wall cell
+int wallTexture(int cell) {
+    unsigned int hash = (unsigned int)cell * 2654435761u;
+    return (int)((hash >> 24) % TEXTURE_COUNT);
+}
+
+// Function to get the glyph of one texel at a wall shade
+char wallGlyph(int texture, int u, int v, int shade, int threshold) {
+    int level = TEXTURES[texture][v][u] - '0';
+    return shadeGlyph(WALL_RAMP, shade + (TEXTURE_LEVELS - 1 - level) * SHADE_BAND, threshold);
+}
+
+// Function to fill one cache entry
+static void buildColumn(char* column, int texture, int u, int ceiling, int height, int phase,
+                        const unsigned char (*thresholds)[4]) {
+    int floor = height - ceiling;
+    int span = floor - ceiling + 1;
+    
+    // The ceiling row follows from the distance, so the distance does too
+    float distance = height / (height / 2.0f - ceiling);
+    int shade = wallShade(distance);
+    
+    for (int y = 0; y < height; y++) {
+        if (y < ceiling || y > floor) {
+            column[y] = ' ';
+        } else {
+            int v = std::min((y - ceiling) * TEXTURE_SIZE / span, TEXTURE_SIZE - 1);
+            column[y] = wallGlyph(texture, u, v, shade, thresholds[y & 3][phase]);
+        }
+    }
+}
+
+// Function to size the column cache for a screen height, emptying it when
+// the height changes
+void prepareTexturedColumns(int height) {
+    ColumnCache& cache = columnCache;
+    if (cache.height == height) return;
+    // Slices taller than twice the screen are rare enough to draw directly
+    cache.height = height;
+    cache.minCeiling = -height / 2;
+    cache.ceilingCount = height / 2 - cache.minCeiling + 1;
+    size_t entries = (size_t)TEXTURE_COUNT * TEXTURE_SIZE * DITHER_PHASES * cache.ceilingCount;
+    cache.glyphs.assign(entries * height, ' ');
+    cache.filled.assign(entries, 0);
+    cache.thresholds = NULL;
+}
+
+// Function to get a whole screen column of textured wall from the column cache
+const char* texturedColumn(int texture, int u, int ceiling, int height, int phase) {
+    ColumnCache& cache = columnCache;
+    const unsigned char (*thresholds)[4] = ditherThresholds();
+    if (cache.height != height) {
+        prepareTexturedColumns(height);
+    } else if (cache.thresholds != thresholds) {
+        std::fill(cache.filled.begin(), cache.filled.end(), 0);
+    }
+    cache.thresholds = thresholds;
+    
+    int row = ceiling - cache.minCeiling;
+    if (row < 0 || row >= cache.ceilingCount) return NULL;
+    
+    size_t entry = (((size_t)texture * TEXTURE_SIZE + u) * DITHER_PHASES + phase) * cache.ceilingCount + row;
+    char* column = &cache.glyphs[entry * height];
+    if (!cache.filled[entry]) {
+        buildColumn(column, texture, u, ceiling, height, phase, thresholds);
+        cache.filled[entry] = 1;
+    }
+    return column;
+}
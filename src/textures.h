@@ -0,0 +1,29 @@
+#ifndef TEXTURES_H
+#define TEXTURES_H
+
+// Wall textures are small square tiles of brightness levels, from 0 (mortar,
+// grooves) up to TEXTURE_LEVELS - 1 (the plain face). Distance shading turns
+// a level into a glyph, so textures fade out with distance like flat walls;
+// each level below the plain face is one shading band fainter.
+const int TEXTURE_SIZE = 8;
+const int TEXTURE_COUNT = 3;
+const int TEXTURE_LEVELS = 3;
+
+// Function to pick the texture of a wall cell
+int wallTexture(int cell);
+
+// Function to get the glyph of one texel at a wall shade, dithered by a
+// threshold from ditherThresholds()
+char wallGlyph(int texture, int u, int v, int shade, int threshold);
+
+// Function to size the column cache for a screen height, emptying it when
+// the height changes; texturedColumn does so on first use otherwise
+void prepareTexturedColumns(int height);
+
+// Function to get a whole screen column of textured wall from the column
+// cache: rows 0 to height - 1, blank above the ceiling row. The phase is the
+// screen column modulo 4, which picks the column of dither thresholds.
+// Returns NULL when the slice is so close that it is not worth caching.
+const char* texturedColumn(int texture, int u, int ceiling, int height, int phase);
+
+#endif // TEXTURES_H
@@ -0,0 +1,134 @@
+#include "trace.h"
+#include "profile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> tracingEnabled(false);
+
+struct TraceEvent {
+    const char* name;
+    double startMs;
+    double durationMs;
+};
+
+// Events of one thread. Only the owning thread writes; the dump reads up
+// to the published count, dropping slots the owner may be rewriting.
+struct ThreadTrace {
+    int tid;
+    const char* name;
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count;
+    
+    ThreadTrace() : tid(0), name(NULL), count(0) {}
+};
+
+// Events kept per thread before the oldest are overwritten
+static const size_t EVENTS_PER_THREAD = 1 << 18;
+
+// Oldest events of a full ring the dump leaves out, as the owning thread
+// is about to overwrite them
+static const size_t DUMP_MARGIN = 1024;
+
+static std::mutex registryMutex;
+static std::vector<ThreadTrace*> threads;
+static std::string tracePath;
+static double traceEpochMs = 0.0;
+static thread_local ThreadTrace* localTrace = NULL;
+
+// Function to get the calling thread's buffer, creating it on first use
+static ThreadTrace* threadTrace() {
+    if (!localTrace) {
+        ThreadTrace* trace = new ThreadTrace();
+        trace->events.resize(EVENTS_PER_THREAD);
+        
+        std::lock_guard<std::mutex> lock(registryMutex);
+        trace->tid = (int)threads.size() + 1;
+        threads.push_back(trace);
+        localTrace = trace;
+    }
+    return localTrace;
+}
+
+// Function to start recording
+bool startTracing(const std::string& path) {
+    FILE* probe = std::fopen(path.c_str(), "w");
+    if (!probe) return false;
+    std::fclose(probe);
+    
+    tracePath = path;
+    traceEpochMs = nowMs();
+    tracingEnabled = true;
+    return true;
+}
+
+// Function to name the calling thread in the timeline
+void traceThreadName(const char* name) {
+    if (!tracingEnabled) return;
+    threadTrace()->name = name;
+}
+
+// Function to record an event that ran from startMs to endMs
+void traceComplete(const char* name, double startMs, double endMs) {
+    if (!tracingEnabled) return;
+    
+    ThreadTrace* trace = threadTrace();
+    size_t n = trace->count.load(std::memory_order_relaxed);
+    TraceEvent& event = trace->events[n % EVENTS_PER_THREAD];
+    event.name = name;
+    event.startMs = startMs;
+    event.durationMs = endMs - startMs;
+    trace->count.store(n + 1, std::memory_order_release);
+}
+
+// Function to write everything recorded so far
+bool dumpTrace() {
+    if (tracePath.empty()) return false;
+    
+    FILE* out = std::fopen(tracePath.c_str(), "w");
+    if (!out) return false;
+    
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"fps_game\"}}");
+    
+    for (size_t t = 0; t < threads.size(); t++) {
+        ThreadTrace* trace = threads[t];
+        std::fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     trace->tid, trace->name ? trace->name : "thread");
+        
+        size_t count = trace->count.load(std::memory_order_acquire);
+        size_t first = count > EVENTS_PER_THREAD - DUMP_MARGIN ? count - (EVENTS_PER_THREAD - DUMP_MARGIN) : 0;
+        for (size_t i = first; i < count; i++) {
+            TraceEvent event = trace->events[i % EVENTS_PER_THREAD];
+            
+            // The owner keeps recording; once it has started on the event
+            // that reuses this slot the copy may be torn, so it is dropped
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (trace->count.load(std::memory_order_relaxed) - i >= EVENTS_PER_THREAD) continue;
+            std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.name, trace->tid, (event.startMs - traceEpochMs) * 1000.0,
+                         event.durationMs * 1000.0);
+        }
+    }
+    
+    std::fprintf(out, "\n]}\n");
+    bool ok = std::ferror(out) == 0;
+    std::fclose(out);
+    return ok;
+}
+
+// Function to write the trace and stop recording
+void stopTracing() {
+    if (!tracingEnabled) return;
+    dumpTrace();
+    tracingEnabled = false;
+}
+
+TraceScope::TraceScope(const char* n) : name(n), start(tracingEnabled ? nowMs() : 0.0) {}
+
+TraceScope::~TraceScope() {
+    if (tracingEnabled) traceComplete(name, start, nowMs());
+}
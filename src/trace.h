@@ -0,0 +1,41 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+// Timeline instrumentation in Chrome trace-event format.
+//
+// Every thread records complete ("X") events into its own fixed-size ring,
+// so recording takes no locks; when a ring is full the oldest events are
+// overwritten. The file can be opened in Perfetto or chrome://tracing.
+
+// True while events are being recorded
+extern std::atomic<bool> tracingEnabled;
+
+// Function to start recording; dumpTrace() writes to path
+bool startTracing(const std::string& path);
+
+// Function to name the calling thread in the timeline
+void traceThreadName(const char* name);
+
+// Function to record an event that ran from startMs to endMs (see nowMs()).
+// The name must be a string literal or otherwise outlive the trace.
+void traceComplete(const char* name, double startMs, double endMs);
+
+// Function to write everything recorded so far, returns false on error
+bool dumpTrace();
+
+// Function to write the trace and stop recording
+void stopTracing();
+
+// Records the lifetime of a scope as one event
+struct TraceScope {
+    const char* name;
+    double start;
+    
+    explicit TraceScope(const char* n);
+    ~TraceScope();
+};
+
+#endif // TRACE_H